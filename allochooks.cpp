@@ -0,0 +1,140 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Replacement of the allocation functions for the allocation statistics
+ * build (ENABLE_ALLOC_STATS), linked only into the program. The C library
+ * functions are interposed, so the allocations of the Qt and Drumstick
+ * libraries are counted too, and the C++ operators use them. Block sizes
+ * are the usable sizes reported by the GNU C library.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+#include "allocstats.h"
+
+#if !defined(__GLIBC__)
+#error "ENABLE_ALLOC_STATS requires the GNU C library"
+#endif
+
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+static inline void* counted(void* ptr)
+{
+    if (ptr != nullptr) {
+        AllocStats::allocated(malloc_usable_size(ptr));
+    }
+    return ptr;
+}
+
+void* malloc(size_t size) noexcept
+{
+    return counted(__libc_malloc(size));
+}
+
+void* calloc(size_t count, size_t size) noexcept
+{
+    return counted(__libc_calloc(count, size));
+}
+
+void* realloc(void* ptr, size_t size) noexcept
+{
+    size_t oldSize = ptr != nullptr ? malloc_usable_size(ptr) : 0;
+    void* result = __libc_realloc(ptr, size);
+    if (ptr != nullptr && (result != nullptr || size == 0)) {
+        AllocStats::freed(oldSize);
+    }
+    return counted(result);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept
+{
+    return counted(__libc_memalign(alignment, size));
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    return counted(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) noexcept
+{
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    void* result = counted(__libc_memalign(alignment, size));
+    if (result == nullptr) {
+        return ENOMEM;
+    }
+    *ptr = result;
+    return 0;
+}
+
+void free(void* ptr) noexcept
+{
+    if (ptr != nullptr) {
+        AllocStats::freed(malloc_usable_size(ptr));
+        __libc_free(ptr);
+    }
+}
+
+}
+
+static void* allocate(std::size_t size)
+{
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+static void* allocateAligned(std::size_t size, std::align_val_t alignment)
+{
+    void* ptr = memalign(static_cast<std::size_t>(alignment), size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return std::malloc(size == 0 ? 1 : size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return std::malloc(size == 0 ? 1 : size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
@@ -0,0 +1,98 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ostream>
+#include <QString>
+#include "allocstats.h"
+
+namespace {
+
+/*
+ * Plain counters with constant initialization: they are used by the
+ * allocation functions before and after the static constructors run.
+ */
+struct PhaseCounters {
+    std::atomic<qint64> allocations;
+    std::atomic<qint64> frees;
+    std::atomic<qint64> bytes;
+    std::atomic<qint64> peakLiveBytes;
+};
+
+PhaseCounters s_phases[AllocStats::PhaseCount];
+std::atomic<qint64> s_liveBytes(0);
+
+}
+
+#if defined(ENABLE_ALLOC_STATS)
+
+void AllocStats::allocated(std::size_t size)
+{
+    PhaseCounters& phase = s_phases[t_phase];
+    phase.allocations.fetch_add(1, std::memory_order_relaxed);
+    phase.bytes.fetch_add(size, std::memory_order_relaxed);
+    qint64 live = s_liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    qint64 peak = phase.peakLiveBytes.load(std::memory_order_relaxed);
+    while (live > peak && !phase.peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) { }
+}
+
+void AllocStats::freed(std::size_t size)
+{
+    s_phases[t_phase].frees.fetch_add(1, std::memory_order_relaxed);
+    s_liveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+#endif
+
+AllocStats::Counters AllocStats::counters(Phase phase)
+{
+    const PhaseCounters& c = s_phases[phase];
+    return { c.allocations.load(), c.frees.load(), c.bytes.load(), c.peakLiveBytes.load() };
+}
+
+qint64 AllocStats::liveBytes()
+{
+    return s_liveBytes.load();
+}
+
+const char *AllocStats::phaseName(Phase phase)
+{
+    static const char* const names[PhaseCount] = {
+        "other", "read", "load", "sort", "thin", "encode", "write"
+    };
+    return names[phase];
+}
+
+/**
+ * Prints the counters of the phases with some allocation.
+ */
+void AllocStats::print(std::ostream &out)
+{
+    out << QString("%1 %2 %3 %4 %5\n").arg("phase", -8).arg("allocs", 12).arg("frees", 12)
+           .arg("MiB", 10).arg("peak MiB", 10).toStdString();
+    for (int i = 0; i < PhaseCount; ++i) {
+        Counters c = counters(static_cast<Phase>(i));
+        if (c.allocations == 0 && c.frees == 0) {
+            continue;
+        }
+        out << QString("%1 %2 %3 %4 %5\n").arg(phaseName(static_cast<Phase>(i)), -8)
+               .arg(c.allocations, 12).arg(c.frees, 12)
+               .arg(c.bytes / 1048576.0, 10, 'f', 2)
+               .arg(c.peakLiveBytes / 1048576.0, 10, 'f', 2).toStdString();
+    }
+    out << "live: " << QString::number(liveBytes() / 1048576.0, 'f', 2).toStdString() << " MiB" << std::endl;
+}
@@ -0,0 +1,86 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ALLOCSTATS_H
+#define ALLOCSTATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <iosfwd>
+#include <QtGlobal>
+
+/**
+ * Allocation counters by conversion phase.
+ *
+ * Built with the CMake option ENABLE_ALLOC_STATS, the program replaces
+ * the allocation functions (malloc and operator new families), calling
+ * allocated() and freed() for every block, including the storage of Qt
+ * containers. Each allocation is attributed to the phase of its thread,
+ * set by a Scope. The peak live bytes of a phase is the highest amount of
+ * memory in use by the whole process while any thread was in that phase.
+ * Without the option, a Scope does nothing. Scopes are inline, so the
+ * conversion library marks its phases without depending on the counters,
+ * which are in the program.
+ */
+class AllocStats
+{
+public:
+    enum Phase { Other, Read, Load, Sort, Thin, Encode, Write, PhaseCount };
+
+    struct Counters {
+        qint64 allocations;
+        qint64 frees;
+        qint64 bytes;
+        qint64 peakLiveBytes;
+    };
+
+#if defined(ENABLE_ALLOC_STATS)
+    class Scope
+    {
+    public:
+        explicit Scope(Phase phase) : m_previous(t_phase) { t_phase = phase; }
+        ~Scope() { t_phase = m_previous; }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        int m_previous;
+    };
+
+    static void allocated(std::size_t size);
+    static void freed(std::size_t size);
+#else
+    class Scope
+    {
+    public:
+        explicit Scope(Phase) { }
+    };
+#endif
+
+    static Counters counters(Phase phase);
+    static qint64 liveBytes();
+    static const char* phaseName(Phase phase);
+    static void print(std::ostream& out);
+
+#if defined(ENABLE_ALLOC_STATS)
+private:
+    static inline thread_local int t_phase = Other;
+#endif
+};
+
+#endif // ALLOCSTATS_H
@@ -0,0 +1,389 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QFileInfo>
+#include <QtEndian>
+#include "archivereader.h"
+#if defined(HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+static const int TAR_BLOCK = 512;
+static const quint32 ZIP_LOCAL_SIGNATURE = 0x04034b50;
+static const quint32 ZIP_CENTRAL_SIGNATURE = 0x02014b50;
+static const quint32 ZIP_END_SIGNATURE = 0x06054b50;
+static const int ZIP_LOCAL_SIZE = 30;
+static const int ZIP_CENTRAL_SIZE = 46;
+static const int ZIP_END_SIZE = 22;
+static const qint64 MAX_MEMBER_SIZE = Q_INT64_C(1) << 30;
+
+static inline quint16 le16(const char* p)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(p));
+}
+
+static inline quint32 le32(const char* p)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(p));
+}
+
+ArchiveReader::ArchiveReader(const QString &fileName) :
+    m_file(fileName),
+    m_zip(false),
+    m_entry(0)
+{
+    setPatterns(QStringList(), QStringList());
+}
+
+bool ArchiveReader::isArchive(const QString &fileName)
+{
+    QString ext = QFileInfo(fileName).suffix().toLower();
+    return ext == "zip" || ext == "tar";
+}
+
+void ArchiveReader::setPatterns(const QStringList &include, const QStringList &exclude)
+{
+    auto compile = [](const QStringList& globs) {
+        QList<Pattern> patterns;
+        foreach(const QString& glob, globs) {
+            patterns.append({ QRegularExpression(QRegularExpression::wildcardToRegularExpression(glob),
+                                                 QRegularExpression::CaseInsensitiveOption),
+                              glob.contains('/') });
+        }
+        return patterns;
+    };
+    m_include = compile(include.isEmpty() ? QStringList{"*.wrk"} : include);
+    m_exclude = compile(exclude);
+}
+
+bool ArchiveReader::selected(const QString &name) const
+{
+    const QString fileName = name.section('/', -1);
+    auto matches = [&](const QList<Pattern>& patterns) {
+        foreach(const Pattern& pattern, patterns) {
+            if (pattern.regexp.match(pattern.path ? name : fileName).hasMatch()) {
+                return true;
+            }
+        }
+        return false;
+    };
+    return matches(m_include) && !matches(m_exclude);
+}
+
+bool ArchiveReader::fail(const QString &error)
+{
+    m_errorString = m_file.fileName() + ": " + error;
+    return false;
+}
+
+bool ArchiveReader::open()
+{
+    m_zip = QFileInfo(m_file.fileName()).suffix().toLower() == "zip";
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return fail("cannot read file");
+    }
+    return !m_zip || readZipDirectory();
+}
+
+/**
+ * Reads the next selected member.
+ * @return false at the end of the archive, or on error.
+ */
+bool ArchiveReader::next(ArchiveMember &member)
+{
+    if (hasError()) {
+        return false;
+    }
+    member = ArchiveMember();
+    return m_zip ? nextZip(member) : nextTar(member);
+}
+
+/*
+ * The central directory is located by the end record, at the end of the
+ * file, possibly followed by a comment of up to 64 KiB.
+ */
+bool ArchiveReader::readZipDirectory()
+{
+    qint64 size = m_file.size();
+    qint64 tail = qMin<qint64>(size, ZIP_END_SIZE + 0xffff);
+    if (size < ZIP_END_SIZE || !m_file.seek(size - tail)) {
+        return fail("invalid zip archive");
+    }
+    QByteArray buffer = m_file.read(tail);
+    int end = -1;
+    for (int i = buffer.size() - ZIP_END_SIZE; i >= 0; --i) {
+        if (le32(buffer.constData() + i) == ZIP_END_SIGNATURE) {
+            end = i;
+            break;
+        }
+    }
+    if (end < 0) {
+        return fail("invalid zip archive");
+    }
+    const char* p = buffer.constData() + end;
+    int entries = le16(p + 10);
+    qint64 dirSize = le32(p + 12);
+    qint64 dirOffset = le32(p + 16);
+    if (entries == 0xffff || dirOffset == 0xffffffff) {
+        return fail("zip64 archives are not supported");
+    }
+    if (dirOffset + dirSize > size || !m_file.seek(dirOffset)) {
+        return fail("invalid zip central directory");
+    }
+    QByteArray dir = m_file.read(dirSize);
+    int pos = 0;
+    for (int i = 0; i < entries; ++i) {
+        if (pos + ZIP_CENTRAL_SIZE > dir.size() || le32(dir.constData() + pos) != ZIP_CENTRAL_SIGNATURE) {
+            return fail("invalid zip central directory");
+        }
+        const char* e = dir.constData() + pos;
+        int nameLength = le16(e + 28);
+        int skip = nameLength + le16(e + 30) + le16(e + 32);
+        if (pos + ZIP_CENTRAL_SIZE + skip > dir.size()) {
+            return fail("invalid zip central directory");
+        }
+        ZipEntry entry;
+        entry.flags = le16(e + 8);
+        entry.method = le16(e + 10);
+        entry.crc = le32(e + 16);
+        entry.compressedSize = le32(e + 20);
+        entry.size = le32(e + 24);
+        entry.localOffset = le32(e + 42);
+        QByteArray name(e + ZIP_CENTRAL_SIZE, nameLength);
+        entry.name = (entry.flags & 0x800) ? QString::fromUtf8(name) : QString::fromLatin1(name);
+        if (!entry.name.endsWith('/')) {
+            m_entries.append(entry);
+        }
+        pos += ZIP_CENTRAL_SIZE + skip;
+    }
+    return true;
+}
+
+bool ArchiveReader::nextZip(ArchiveMember &member)
+{
+    while (m_entry < m_entries.size()) {
+        const ZipEntry& entry = m_entries.at(m_entry++);
+        if (!selected(entry.name)) {
+            continue;
+        }
+        if (entry.compressedSize == 0xffffffff || entry.size == 0xffffffff ||
+            entry.localOffset == 0xffffffff) {
+            return fail(entry.name + ": zip64 members are not supported");
+        }
+        char local[ZIP_LOCAL_SIZE];
+        if (!m_file.seek(entry.localOffset) || m_file.read(local, ZIP_LOCAL_SIZE) != ZIP_LOCAL_SIZE ||
+            le32(local) != ZIP_LOCAL_SIGNATURE) {
+            return fail(entry.name + ": invalid local header");
+        }
+        qint64 dataOffset = entry.localOffset + ZIP_LOCAL_SIZE + le16(local + 26) + le16(local + 28);
+        if (entry.compressedSize > MAX_MEMBER_SIZE || !m_file.seek(dataOffset)) {
+            return fail(entry.name + ": invalid member");
+        }
+        member.name = entry.name;
+        member.data = m_file.read(entry.compressedSize);
+        member.method = (entry.flags & 1) ? Encrypted : entry.method;
+        member.size = entry.size;
+        member.crc = entry.crc;
+        member.hasCrc = true;
+        if (member.data.size() != entry.compressedSize) {
+            return fail(entry.name + ": truncated member");
+        }
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Tar numbers are octal text, or big endian binary when the first byte
+ * has the high bit set (GNU extension for big files).
+ */
+static qint64 tarNumber(const char* field, int length)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(field);
+    qint64 value = 0;
+    if (p[0] & 0x80) {
+        for (int i = 1; i < length; ++i) {
+            value = (value << 8) | p[i];
+        }
+        return value;
+    }
+    for (int i = 0; i < length && field[i] != '\0'; ++i) {
+        if (field[i] >= '0' && field[i] <= '7') {
+            value = value * 8 + (field[i] - '0');
+        } else if (field[i] != ' ') {
+            break;
+        }
+    }
+    return value;
+}
+
+static QByteArray tarString(const char* field, int length)
+{
+    return QByteArray(field, qstrnlen(field, length));
+}
+
+/*
+ * Pax extended headers are records "length key=value\n"; only the path
+ * is used.
+ */
+static QString paxPath(const QByteArray& data)
+{
+    QString path;
+    int pos = 0;
+    while (pos < data.size()) {
+        int space = data.indexOf(' ', pos);
+        int length = space > pos ? data.mid(pos, space - pos).toInt() : 0;
+        if (length <= 0 || pos + length > data.size()) {
+            break;
+        }
+        QByteArray record = data.mid(space + 1, pos + length - space - 2);
+        if (record.startsWith("path=")) {
+            path = QString::fromUtf8(record.mid(5));
+        }
+        pos += length;
+    }
+    return path;
+}
+
+bool ArchiveReader::nextTar(ArchiveMember &member)
+{
+    QString longName;
+    forever {
+        char header[TAR_BLOCK];
+        qint64 n = m_file.read(header, TAR_BLOCK);
+        if (n == 0) {
+            return false;
+        }
+        if (n != TAR_BLOCK) {
+            return fail("truncated tar archive");
+        }
+        qint64 checksum = 0;
+        bool empty = true;
+        for (int i = 0; i < TAR_BLOCK; ++i) {
+            empty &= header[i] == '\0';
+            checksum += (i >= 148 && i < 156) ? ' ' : static_cast<uchar>(header[i]);
+        }
+        if (empty) {
+            return false;
+        }
+        if (checksum != tarNumber(header + 148, 8)) {
+            return fail("invalid tar header");
+        }
+        qint64 size = tarNumber(header + 124, 12);
+        qint64 padded = (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+        char type = header[156];
+        if (type == 'L' || type == 'x') {
+            if (size > MAX_MEMBER_SIZE) {
+                return fail("invalid tar header");
+            }
+            QByteArray data = m_file.read(padded).left(size);
+            longName = (type == 'L') ? QString::fromUtf8(tarString(data.constData(), data.size())) : paxPath(data);
+            continue;
+        }
+        QString name = longName;
+        longName.clear();
+        if (name.isEmpty()) {
+            name = QString::fromUtf8(tarString(header, 100));
+            QByteArray prefix = tarString(header + 345, 155);
+            if (qstrncmp(header + 257, "ustar", 5) == 0 && !prefix.isEmpty()) {
+                name = QString::fromUtf8(prefix) + '/' + name;
+            }
+        }
+        bool regular = type == '0' || type == '\0' || type == '7';
+        if (!regular || !selected(name)) {
+            if (!m_file.seek(m_file.pos() + padded)) {
+                return fail("truncated tar archive");
+            }
+            continue;
+        }
+        if (size > MAX_MEMBER_SIZE) {
+            return fail(name + ": member too large");
+        }
+        member.name = name;
+        member.method = Stored;
+        member.size = size;
+        member.data = m_file.read(size);
+        if (member.data.size() != size || !m_file.seek(m_file.pos() + padded - size)) {
+            return fail(name + ": truncated member");
+        }
+        return true;
+    }
+}
+
+/**
+ * Decompresses and checks the contents of a member.
+ * @param member A member returned by next().
+ * @param error Receives the reason of a failure.
+ * @return The member contents, or an empty array on error.
+ */
+QByteArray ArchiveReader::extract(const ArchiveMember &member, QString *error)
+{
+    QByteArray data;
+    switch (member.method) {
+    case Stored:
+        data = member.data;
+        break;
+#if defined(HAVE_ZLIB)
+    case Deflated: {
+        if (member.size > MAX_MEMBER_SIZE) {
+            *error = "member too large";
+            return QByteArray();
+        }
+        data.resize(member.size);
+        z_stream stream = {};
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            *error = "decompression error";
+            return QByteArray();
+        }
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(member.data.constData()));
+        stream.avail_in = member.data.size();
+        stream.next_out = reinterpret_cast<Bytef*>(data.data());
+        stream.avail_out = data.size();
+        int rc = inflate(&stream, Z_FINISH);
+        bool ok = rc == Z_STREAM_END && qint64(stream.total_out) == member.size;
+        inflateEnd(&stream);
+        if (!ok) {
+            *error = "decompression error";
+            return QByteArray();
+        }
+        break;
+    }
+#else
+    case Deflated:
+        *error = "deflated members need zlib support";
+        return QByteArray();
+#endif
+    case Encrypted:
+        *error = "encrypted members are not supported";
+        return QByteArray();
+    default:
+        *error = QString("unsupported compression method %1").arg(member.method);
+        return QByteArray();
+    }
+    if (data.size() != member.size) {
+        *error = "wrong member size";
+        return QByteArray();
+    }
+#if defined(HAVE_ZLIB)
+    if (member.hasCrc && crc32(0, reinterpret_cast<const Bytef*>(data.constData()), data.size()) != member.crc) {
+        *error = "CRC error";
+        return QByteArray();
+    }
+#endif
+    return data;
+}
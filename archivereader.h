@@ -0,0 +1,101 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARCHIVEREADER_H
+#define ARCHIVEREADER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+
+/**
+ * A file stored in an archive. The data is kept as stored: extract()
+ * decompresses it, so it can be done in another thread.
+ */
+struct ArchiveMember {
+    QString name;           ///< path inside the archive
+    QByteArray data;        ///< stored (maybe compressed) contents
+    int method = 0;         ///< ArchiveReader::Method
+    qint64 size = 0;        ///< uncompressed size
+    quint32 crc = 0;        ///< CRC-32 of the contents
+    bool hasCrc = false;    ///< the CRC is known (zip only)
+};
+
+/**
+ * Sequential reader of the regular files stored in zip and tar archives.
+ *
+ * Tar archives (ustar, with GNU and pax long names) are read as a stream.
+ * Zip archives are read using their central directory; stored members are
+ * always supported, and deflated members when built with zlib. Zip64 and
+ * encrypted members are not supported.
+ *
+ * The members can be selected by name with include and exclude patterns
+ * (shell globs, ignoring case). Patterns containing a '/' match the whole
+ * path, and the others only the file name. Members not selected are
+ * skipped without reading them.
+ */
+class ArchiveReader
+{
+public:
+    enum Method { Encrypted = -1, Stored = 0, Deflated = 8 };
+
+    explicit ArchiveReader(const QString& fileName);
+
+    static bool isArchive(const QString& fileName);
+    static QByteArray extract(const ArchiveMember& member, QString* error);
+
+    void setPatterns(const QStringList& include, const QStringList& exclude);
+    bool open();
+    bool next(ArchiveMember& member);
+    bool hasError() const { return !m_errorString.isEmpty(); }
+    QString errorString() const { return m_errorString; }
+
+private:
+    struct Pattern {
+        QRegularExpression regexp;
+        bool path;      ///< matches the whole path, instead of the file name
+    };
+    struct ZipEntry {
+        QString name;
+        qint64 localOffset;
+        qint64 compressedSize;
+        qint64 size;
+        int method;
+        int flags;
+        quint32 crc;
+    };
+
+    bool fail(const QString& error);
+    bool selected(const QString& name) const;
+    bool readZipDirectory();
+    bool nextZip(ArchiveMember& member);
+    bool nextTar(ArchiveMember& member);
+
+    QFile m_file;
+    bool m_zip;
+    QList<ZipEntry> m_entries;
+    int m_entry;
+    QList<Pattern> m_include;
+    QList<Pattern> m_exclude;
+    QString m_errorString;
+};
+
+#endif // ARCHIVEREADER_H
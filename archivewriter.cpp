@@ -0,0 +1,231 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QVector>
+#include <QtEndian>
+#include "archivewriter.h"
+
+static const int TAR_BLOCK = 512;
+
+static quint32 crc32Of(const QByteArray& data)
+{
+    static const auto table = [] {
+        QVector<quint32> t(256);
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    quint32 crc = 0xffffffff;
+    for (char byte : data) {
+        crc = table[(crc ^ static_cast<uchar>(byte)) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
+}
+
+ArchiveWriter::ArchiveWriter(QIODevice *device, Format format, int bufferSize) :
+    m_device(device),
+    m_format(format),
+    m_bufferSize(bufferSize),
+    m_offset(0)
+{
+    QDateTime now = QDateTime::currentDateTime();
+    m_mtime = static_cast<quint32>(now.toMSecsSinceEpoch() / 1000);
+    m_dosTime = (now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() / 2);
+    m_dosDate = ((qMax(now.date().year(), 1980) - 1980) << 9) | (now.date().month() << 5) | now.date().day();
+    m_buffer.reserve(bufferSize);
+}
+
+ArchiveWriter::Format ArchiveWriter::formatOf(const QString &fileName)
+{
+    return QFileInfo(fileName).suffix().toLower() == "zip" ? Zip : Tar;
+}
+
+bool ArchiveWriter::fail(const QString &error)
+{
+    if (m_errorString.isEmpty()) {
+        m_errorString = error;
+    }
+    return false;
+}
+
+bool ArchiveWriter::put(const char *data, qint64 len)
+{
+    if (!m_errorString.isEmpty()) {
+        return false;
+    }
+    m_offset += len;
+    if (m_buffer.size() + len > m_bufferSize && !flush()) {
+        return false;
+    }
+    if (len >= m_bufferSize) {
+        if (m_device->write(data, len) != len) {
+            return fail(m_device->errorString());
+        }
+        return true;
+    }
+    m_buffer.append(data, len);
+    return true;
+}
+
+bool ArchiveWriter::flush()
+{
+    if (!m_buffer.isEmpty()) {
+        if (m_device->write(m_buffer) != m_buffer.size()) {
+            return fail(m_device->errorString());
+        }
+        m_buffer.resize(0);
+    }
+    return true;
+}
+
+/**
+ * Appends a file to the archive.
+ * @param name The path of the file inside the archive.
+ * @param data The file contents.
+ * @return false on error.
+ */
+bool ArchiveWriter::addFile(const QString &name, const QByteArray &data)
+{
+    QByteArray utf8 = name.toUtf8();
+    return m_format == Zip ? addZipFile(utf8, data) : addTarFile(utf8, data);
+}
+
+/**
+ * Writes the end of the archive, and flushes the buffer.
+ */
+bool ArchiveWriter::finish()
+{
+    if (m_format == Tar) {
+        QByteArray end(2 * TAR_BLOCK, '\0');
+        put(end);
+        return flush();
+    }
+    if (m_entries.size() > 0xffff) {
+        return fail("too many files for a zip archive");
+    }
+    const qint64 dirOffset = m_offset;
+    foreach(const ZipEntry& entry, m_entries) {
+        uchar header[46];
+        qToLittleEndian<quint32>(0x02014b50, header);
+        qToLittleEndian<quint16>((3 << 8) | 20, header + 4);    // made by: unix
+        qToLittleEndian<quint16>(20, header + 6);
+        qToLittleEndian<quint16>(0x800, header + 8);            // UTF-8 names
+        qToLittleEndian<quint16>(0, header + 10);               // stored
+        qToLittleEndian<quint16>(m_dosTime, header + 12);
+        qToLittleEndian<quint16>(m_dosDate, header + 14);
+        qToLittleEndian<quint32>(entry.crc, header + 16);
+        qToLittleEndian<quint32>(entry.size, header + 20);
+        qToLittleEndian<quint32>(entry.size, header + 24);
+        qToLittleEndian<quint16>(entry.name.size(), header + 28);
+        std::memset(header + 30, 0, 8);                         // extra, comment, disk, attributes
+        qToLittleEndian<quint32>(0100644u << 16, header + 38);
+        qToLittleEndian<quint32>(entry.offset, header + 42);
+        put(reinterpret_cast<const char*>(header), sizeof(header));
+        put(entry.name);
+    }
+    const qint64 dirSize = m_offset - dirOffset;
+    if (m_offset > 0xffffffffLL) {
+        return fail("zip archive too large");
+    }
+    uchar end[22];
+    qToLittleEndian<quint32>(0x06054b50, end);
+    qToLittleEndian<quint16>(0, end + 4);
+    qToLittleEndian<quint16>(0, end + 6);
+    qToLittleEndian<quint16>(m_entries.size(), end + 8);
+    qToLittleEndian<quint16>(m_entries.size(), end + 10);
+    qToLittleEndian<quint32>(dirSize, end + 12);
+    qToLittleEndian<quint32>(dirOffset, end + 16);
+    qToLittleEndian<quint16>(0, end + 20);
+    put(reinterpret_cast<const char*>(end), sizeof(end));
+    return flush();
+}
+
+bool ArchiveWriter::addTarHeader(const QByteArray &name, qint64 size, char type)
+{
+    char header[TAR_BLOCK];
+    std::memset(header, 0, TAR_BLOCK);
+    std::memcpy(header, name.constData(), qMin<qsizetype>(name.size(), 100));
+    std::memcpy(header + 100, "0000644", 7);
+    std::memcpy(header + 108, "0000000", 7);
+    std::memcpy(header + 116, "0000000", 7);
+    qsnprintf(header + 124, 12, "%011llo", static_cast<unsigned long long>(size));
+    qsnprintf(header + 136, 12, "%011o", m_mtime);
+    header[156] = type;
+    std::memcpy(header + 257, "ustar", 6);
+    std::memcpy(header + 263, "00", 2);
+    std::memset(header + 148, ' ', 8);
+    unsigned checksum = 0;
+    for (int i = 0; i < TAR_BLOCK; ++i) {
+        checksum += static_cast<uchar>(header[i]);
+    }
+    qsnprintf(header + 148, 8, "%06o", checksum);
+    return put(header, TAR_BLOCK);
+}
+
+/*
+ * Names longer than 100 bytes are stored in a pax extended header
+ * preceding the file.
+ */
+bool ArchiveWriter::addTarFile(const QByteArray &name, const QByteArray &data)
+{
+    if (name.size() > 100) {
+        QByteArray record = " path=" + name + "\n";
+        int length = record.size() + 1;
+        while (QByteArray::number(length).size() + record.size() != length) {
+            length++;
+        }
+        record.prepend(QByteArray::number(length));
+        QByteArray padding(((record.size() + TAR_BLOCK - 1) / TAR_BLOCK) * TAR_BLOCK - record.size(), '\0');
+        if (!addTarHeader("PaxHeader/" + name.right(90), record.size(), 'x') ||
+            !put(record) || !put(padding)) {
+            return false;
+        }
+    }
+    QByteArray padding(((data.size() + TAR_BLOCK - 1) / TAR_BLOCK) * TAR_BLOCK - data.size(), '\0');
+    return addTarHeader(name, data.size(), '0') && put(data) && put(padding);
+}
+
+bool ArchiveWriter::addZipFile(const QByteArray &name, const QByteArray &data)
+{
+    if (m_offset + 30 + name.size() + data.size() > 0xffffffffLL || name.size() > 0xffff) {
+        return fail("zip archive too large");
+    }
+    ZipEntry entry{ name, crc32Of(data), static_cast<quint32>(data.size()), static_cast<quint32>(m_offset) };
+    uchar header[30];
+    qToLittleEndian<quint32>(0x04034b50, header);
+    qToLittleEndian<quint16>(20, header + 4);
+    qToLittleEndian<quint16>(0x800, header + 6);
+    qToLittleEndian<quint16>(0, header + 8);
+    qToLittleEndian<quint16>(m_dosTime, header + 10);
+    qToLittleEndian<quint16>(m_dosDate, header + 12);
+    qToLittleEndian<quint32>(entry.crc, header + 14);
+    qToLittleEndian<quint32>(entry.size, header + 18);
+    qToLittleEndian<quint32>(entry.size, header + 22);
+    qToLittleEndian<quint16>(name.size(), header + 26);
+    qToLittleEndian<quint16>(0, header + 28);
+    m_entries.append(entry);
+    return put(reinterpret_cast<const char*>(header), sizeof(header)) && put(name) && put(data);
+}
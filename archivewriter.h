@@ -0,0 +1,76 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARCHIVEWRITER_H
+#define ARCHIVEWRITER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QString>
+
+/**
+ * Sequential writer of tar or uncompressed zip archives.
+ *
+ * The files are appended to the device through a large buffer, so many
+ * small files become a few big sequential writes, and the device may be
+ * a pipe or the standard output. Tar archives use pax headers for long
+ * names. Zip archives are limited to 65535 files and 4 GiB (no zip64).
+ */
+class ArchiveWriter
+{
+public:
+    enum Format { Tar, Zip };
+
+    explicit ArchiveWriter(QIODevice* device, Format format, int bufferSize = 1024 * 1024);
+
+    static Format formatOf(const QString& fileName);
+    bool addFile(const QString& name, const QByteArray& data);
+    bool finish();
+    qint64 bytesWritten() const { return m_offset; }
+    QString errorString() const { return m_errorString; }
+
+private:
+    struct ZipEntry {
+        QByteArray name;
+        quint32 crc;
+        quint32 size;
+        quint32 offset;
+    };
+
+    bool fail(const QString& error);
+    bool put(const char* data, qint64 len);
+    bool put(const QByteArray& data) { return put(data.constData(), data.size()); }
+    bool flush();
+    bool addTarFile(const QByteArray& name, const QByteArray& data);
+    bool addTarHeader(const QByteArray& name, qint64 size, char type);
+    bool addZipFile(const QByteArray& name, const QByteArray& data);
+
+    QIODevice* m_device;
+    Format m_format;
+    QByteArray m_buffer;
+    int m_bufferSize;
+    qint64 m_offset;
+    quint32 m_mtime;
+    quint16 m_dosTime;
+    quint16 m_dosDate;
+    QList<ZipEntry> m_entries;
+    QString m_errorString;
+};
+
+#endif // ARCHIVEWRITER_H
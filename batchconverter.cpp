@@ -0,0 +1,755 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QThread>
+#include <QVector>
+#include "allocstats.h"
+#include "batchconverter.h"
+#include "columnarwriter.h"
+#include "ndjsonwriter.h"
+#include "probes.h"
+#include "tracer.h"
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Maximum number of files read ahead of the oldest one not yet appended
+ * to an output archive, bounding the results waiting to be reordered.
+ */
+static const int ORDER_WINDOW_PER_JOB = 8;
+
+/*
+ * Asks the kernel to start reading a file in the background, so it is
+ * in the page cache when the reader stage gets to it.
+ */
+static void prefetchFile(const QString& fileName)
+{
+#if defined(Q_OS_UNIX)
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+        ::posix_fadvise(file.handle(), 0, 0, POSIX_FADV_WILLNEED);
+    }
+#else
+    Q_UNUSED(fileName)
+#endif
+}
+
+/*
+ * FNV-1a hash of the input paths, assigning each input to a shard
+ * independently of the machine and of the other inputs.
+ */
+static quint64 shardHash(const QString& name)
+{
+    quint64 hash = 14695981039346656037ULL;
+    foreach(char c, name.toUtf8()) {
+        hash ^= static_cast<uchar>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+BatchConverter::BatchConverter(int jobs, std::function<void(Sequence&)> configure) :
+    m_jobs(qMax(1, jobs)),
+    m_configure(configure),
+    m_suffix(".mid"),
+    m_testOnly(false),
+    m_durability(OutputCommitter::DurabilityNone),
+    m_archiveFormat(ArchiveWriter::Tar),
+    m_nextIndex(0),
+    m_journal(nullptr),
+    m_shardIndex(0),
+    m_shardCount(1),
+    m_metrics(nullptr),
+    m_wallNanos(0),
+    m_failures(0),
+    m_limitsExceeded(0),
+    m_salvaged(0),
+    m_skipped(0),
+    m_reader(nullptr),
+    m_writer(nullptr),
+    m_inFlight(0)
+{ }
+
+BatchConverter::~BatchConverter()
+{
+    if (m_reader != nullptr) {
+        finish();
+    }
+}
+
+void BatchConverter::addStats(StageStats &stage, qint64 nanos, qint64 bytes)
+{
+    QMutexLocker locker(&m_statsMutex);
+    stage.busyNanos += nanos;
+    stage.items++;
+    stage.bytes += bytes;
+}
+
+/**
+ * Appends all the results to a single archive instead of writing
+ * individual files.
+ * @param fileName The archive file name, or "-" for the standard output.
+ * @param format Tar or uncompressed zip.
+ */
+void BatchConverter::setOutputArchive(const QString &fileName, ArchiveWriter::Format format)
+{
+    m_archiveName = fileName;
+    m_archiveFormat = format;
+}
+
+/**
+ * Converts a list of files.
+ * @return The exit status: failure if any file failed, otherwise the
+ * limit exceeded or salvaged status if any file had it, or success.
+ */
+int BatchConverter::run(const QList<FileJob> &files)
+{
+    if (!start()) {
+        return Sequence::ReturnFailure;
+    }
+    submit(files);
+    return finish();
+}
+
+/**
+ * Starts the threads of the pipeline, waiting for files.
+ * @return false if the output archive cannot be created.
+ */
+bool BatchConverter::start()
+{
+    m_read = m_convert = m_write = StageStats();
+    m_failures = m_limitsExceeded = m_salvaged = m_skipped = 0;
+    m_nextIndex = 0;
+    m_inFlight = 0;
+    m_outputs.clear();
+    m_wall.start();
+
+    if (!m_archiveName.isEmpty() && !m_testOnly) {
+        QIODevice* device;
+        bool ok;
+        if (m_archiveName == "-") {
+            ok = m_stdoutFile.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+            device = &m_stdoutFile;
+        } else {
+            m_archiveFile.setFileName(m_archiveName);
+            ok = m_archiveFile.open(QIODevice::WriteOnly);
+            device = &m_archiveFile;
+        }
+        if (!ok) {
+            std::cerr << "cannot write file: " << m_archiveName.toStdString() << std::endl;
+            return false;
+        }
+        m_archive.reset(new ArchiveWriter(device, m_archiveFormat));
+        m_window.tryAcquire(m_window.available());
+        m_window.release(ORDER_WINDOW_PER_JOB * m_jobs);
+    }
+
+    m_batches.reset(new BoundedQueue<QList<FileJob>>(1024));
+    m_loaded.reset(new BoundedQueue<Item>(2 * m_jobs));
+    m_converted.reset(new BoundedQueue<Item>(2 * m_jobs));
+    m_committer.reset(new OutputCommitter(m_durability));
+    if (m_metrics != nullptr) {
+        BoundedQueue<Item>* loaded = m_loaded.get();
+        BoundedQueue<Item>* converted = m_converted.get();
+        m_metrics->setQueueSampler([loaded, converted]{
+            return MetricsExporter::QueueDepths{ loaded->size(), converted->size() };
+        });
+    }
+    m_reader = QThread::create([this]{ readStage(m_loaded.get()); });
+    m_writer = QThread::create([this]{ writeStage(m_converted.get()); });
+    for (int i = 0; i < m_jobs; ++i) {
+        m_workers.append(QThread::create([this]{ convertStage(m_loaded.get(), m_converted.get()); }));
+    }
+    m_reader->start();
+    m_writer->start();
+    foreach(QThread* worker, m_workers) {
+        worker->start();
+    }
+    return true;
+}
+
+/**
+ * Queues a batch of files for the running pipeline. Their output names
+ * are reserved before the conversion starts.
+ */
+void BatchConverter::submit(const QList<FileJob> &files)
+{
+    QList<FileJob> batch = files;
+    for (FileJob& job : batch) {
+        if (!ArchiveReader::isArchive(job.input)) {
+            job.output = claimOutput(job.output, job.input);
+        }
+    }
+    // the batch is in flight until its end marker is written
+    m_inFlight++;
+    m_batches->push(batch);
+}
+
+/**
+ * Converts the files already submitted, and stops the pipeline.
+ * @return The exit status: failure if any file failed, otherwise the
+ * limit exceeded or salvaged status if any file had it, or success.
+ */
+int BatchConverter::finish()
+{
+    m_batches->close();
+    m_reader->wait();
+    foreach(QThread* worker, m_workers) {
+        worker->wait();
+        delete worker;
+    }
+    m_workers.clear();
+    m_converted->close();
+    m_writer->wait();
+    delete m_reader;
+    delete m_writer;
+    m_reader = m_writer = nullptr;
+    if (m_metrics != nullptr) {
+        m_metrics->setQueueSampler(nullptr);
+    }
+    if (m_archiveFile.isOpen()) {
+#if defined(Q_OS_UNIX)
+        if (m_durability != OutputCommitter::DurabilityNone && m_archiveFile.flush()) {
+            ::fsync(m_archiveFile.handle());
+        }
+#endif
+        if (!m_archive->errorString().isEmpty()) {
+            m_archiveFile.cancelWriting();
+        } else if (!m_archiveFile.commit()) {
+            std::cerr << "cannot write file: " << m_archiveName.toStdString() << std::endl;
+            m_failures++;
+        }
+    }
+    m_archive.reset();
+    m_committer.reset();
+    m_stdoutFile.close();
+    QMutexLocker locker(&m_statsMutex);
+    m_wallNanos = m_wall.nsecsElapsed();
+
+    if (m_failures > 0) {
+        return Sequence::ReturnFailure;
+    }
+    if (m_limitsExceeded > 0) {
+        return Sequence::ReturnLimitExceeded;
+    }
+    if (m_salvaged > 0) {
+        return Sequence::ReturnSalvaged;
+    }
+    return Sequence::ReturnSuccess;
+}
+
+void BatchConverter::setDumpFormat(const QString &format)
+{
+    m_dumpFormat = format;
+    m_suffix = format.isEmpty() ? ".mid" : "." + format;
+}
+
+/*
+ * Numbers the items in input order, and counts them in flight until they
+ * are written. When they go to an output archive, waits until the writer
+ * is not too far behind.
+ */
+bool BatchConverter::pushItem(BoundedQueue<Item> *output, Item item)
+{
+    item.index = m_nextIndex++;
+    if (!item.marker) {
+        m_inFlight++;
+    }
+    if (!m_archiveName.isEmpty() && !m_testOnly) {
+        m_window.acquire();
+    }
+    return output->push(std::move(item));
+}
+
+/*
+ * Inputs of other shards are not converted. The shard is chosen by the
+ * normalized input path, as given, and not by the output name, which may
+ * get a suffix depending on the other inputs. The inputs completed
+ * according to the journal are skipped later, by the workers, after
+ * checking that their contents have not changed.
+ */
+bool BatchConverter::isSkipped(const QString &input)
+{
+    if (m_shardCount > 1 && shardHash(QDir::cleanPath(input)) % m_shardCount != quint64(m_shardIndex)) {
+        m_skipped++;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Reserves an output file name, adding a numeric suffix when an earlier
+ * input already has it: files with the same name in different directories
+ * or archives, or differing only in their last suffix, would otherwise
+ * overwrite each other. The names of plain files are reserved when they
+ * are submitted, in the order of the inputs, and the archive members as
+ * they are read, so the result does not depend on the shard or the
+ * journal. An input submitted again keeps its name.
+ */
+QString BatchConverter::claimOutput(const QString &output, const QString &input)
+{
+    QMutexLocker locker(&m_outputsMutex);
+    QString claimed = output;
+    QFileInfo finfo(output);
+    for (int n = 2; m_outputs.contains(claimed) && m_outputs.value(claimed) != input; ++n) {
+        claimed = finfo.path() + '/' + finfo.completeBaseName() + '-' + QString::number(n) + '.' + finfo.suffix();
+    }
+    if (claimed != output) {
+        std::cerr << "duplicate output name: " << input.toStdString()
+                  << " is written as " << claimed.toStdString() << std::endl;
+    }
+    m_outputs.insert(claimed, input);
+    return claimed;
+}
+
+void BatchConverter::readStage(BoundedQueue<Item> *output)
+{
+    Tracer::setThreadName("reader");
+    QList<FileJob> files;
+    while (m_batches->pop(files)) {
+        if (!readFiles(files, output)) {
+            break;
+        }
+        Item marker;
+        marker.marker = true;
+        marker.returnCode = Sequence::ReturnSuccess;
+        if (!pushItem(output, std::move(marker))) {
+            break;
+        }
+    }
+    output->close();
+}
+
+bool BatchConverter::readFiles(const QList<FileJob> &files, BoundedQueue<Item> *output)
+{
+    QElapsedTimer timer;
+    for (int i = 0; i < files.size(); ++i) {
+        const FileJob& job = files[i];
+        if (i + 1 < files.size()) {
+            prefetchFile(files[i + 1].input);
+        }
+        if (ArchiveReader::isArchive(job.input)) {
+            if (!readArchive(job, output)) {
+                return false;
+            }
+            continue;
+        }
+        Item item;
+        item.output = job.output;
+        item.entryName = QFileInfo(job.output).fileName();
+        if (isSkipped(job.input)) {
+            continue;
+        }
+        timer.start();
+        readFile(job.input, item);
+        item.readNanos = timer.nsecsElapsed();
+        addStats(m_read, item.readNanos, item.member.data.size());
+        if (!pushItem(output, std::move(item))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BatchConverter::readFile(const QString &fileName, Item &item)
+{
+    Tracer::setFile(fileName);
+    TraceSpan span("read");
+    AllocStats::Scope allocScope(AllocStats::Read);
+    item.member.name = fileName;
+    item.returnCode = Sequence::ReturnSuccess;
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+#if defined(Q_OS_UNIX)
+        ::posix_fadvise(file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        item.member.data = file.readAll();
+        item.member.size = item.member.data.size();
+    }
+    if (file.error() != QFileDevice::NoError) {
+        std::cerr << "cannot read file: " << fileName.toStdString() << std::endl;
+        item.returnCode = Sequence::ReturnFailure;
+        item.errorClass = MetricsExporter::ReadError;
+    }
+}
+
+/*
+ * Queues the selected members of an archive, still compressed. Their
+ * output names keep the relative paths of the archive, but never go
+ * outside of the output directory.
+ */
+bool BatchConverter::readArchive(const FileJob &job, BoundedQueue<Item> *output)
+{
+    AllocStats::Scope allocScope(AllocStats::Read);
+    QElapsedTimer timer;
+    timer.start();
+    ArchiveReader archive(job.input);
+    archive.setPatterns(m_include, m_exclude);
+    QDir outputDir(job.output);
+    Item item;
+    item.returnCode = Sequence::ReturnSuccess;
+    bool ok = archive.open();
+    qint64 traceStart = Tracer::now();
+    while (ok && archive.next(item.member)) {
+        QString path = QDir::cleanPath(item.member.name);
+        while (path.startsWith('/')) {
+            path.remove(0, 1);
+        }
+        if (path == ".." || path.startsWith("../")) {
+            path = path.section('/', -1);
+        }
+        QFileInfo finfo(path);
+        item.entryName = QDir::cleanPath(finfo.path() + '/' + finfo.completeBaseName() + m_suffix);
+        item.member.name = job.input + ":" + item.member.name;
+        // the name is claimed even when skipped, to keep the same suffixes in all the shards
+        bool skipped = isSkipped(QDir::cleanPath(job.input) + ":" + path);
+        item.output = claimOutput(outputDir.absoluteFilePath(item.entryName), item.member.name);
+        item.entryName = outputDir.relativeFilePath(item.output);
+        item.readNanos = timer.nsecsElapsed();
+        timer.start();
+        if (Tracer::isEnabled()) {
+            Tracer::setFile(item.member.name);
+            Tracer::complete("read", traceStart, Tracer::now());
+            traceStart = Tracer::now();
+        }
+        if (skipped) {
+            continue;
+        }
+        addStats(m_read, item.readNanos, item.member.data.size());
+        if (!pushItem(output, item)) {
+            return false;
+        }
+    }
+    if (archive.hasError()) {
+        std::cerr << archive.errorString().toStdString() << std::endl;
+        item = Item();
+        item.member.name = job.input;
+        item.returnCode = Sequence::ReturnFailure;
+        item.errorClass = MetricsExporter::ArchiveError;
+        item.readNanos = 0;
+        return pushItem(output, std::move(item));
+    }
+    return true;
+}
+
+void BatchConverter::convertStage(BoundedQueue<Item> *input, BoundedQueue<Item> *output)
+{
+    Tracer::setThreadName("worker");
+    Sequence seq;
+    m_configure(seq);
+    QElapsedTimer timer;
+    Item item;
+    while (input->pop(item)) {
+        if (item.marker) {
+            output->push(std::move(item));
+            continue;
+        }
+        timer.start();
+        Tracer::setFile(item.member.name);
+        qint64 size = item.member.data.size();
+        if (item.returnCode == Sequence::ReturnSuccess) {
+            TraceSpan span("convert");
+            QString error;
+            QByteArray data;
+            {
+                TraceSpan extractSpan("extract");
+                AllocStats::Scope allocScope(AllocStats::Read);
+                data = ArchiveReader::extract(item.member, &error);
+            }
+            item.member.data.clear();
+            if (!error.isEmpty()) {
+                std::cerr << item.member.name.toStdString() << ": " << error.toStdString() << std::endl;
+                item.returnCode = Sequence::ReturnFailure;
+                item.errorClass = MetricsExporter::ExtractError;
+            } else {
+                if (m_journal != nullptr) {
+                    item.inputHash = QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+                    item.completed = m_journal->isCompleted(item.member.name, item.inputHash);
+                }
+                if (!item.completed) {
+                    item.result = convert(seq, data, &item.returnCode);
+                    if (item.returnCode == Sequence::ReturnLimitExceeded) {
+                        item.errorClass = MetricsExporter::LimitError;
+                    } else if (item.returnCode == Sequence::ReturnFailure) {
+                        // a song loaded but not saved failed to encode
+                        item.errorClass = seq.hasSong() ? MetricsExporter::EncodeError : MetricsExporter::ParseError;
+                    }
+                    if (item.returnCode != Sequence::ReturnSuccess) {
+                        std::cerr << "conversion failed: " << item.member.name.toStdString() << std::endl;
+                    }
+                    if (m_journal != nullptr && !item.result.isEmpty()) {
+                        item.outputHash = QCryptographicHash::hash(item.result, QCryptographicHash::Sha256);
+                    }
+                }
+            }
+        }
+        item.convertNanos = timer.nsecsElapsed();
+        addStats(m_convert, item.convertNanos, size);
+        output->push(std::move(item));
+    }
+    seq.clear();
+}
+
+QByteArray BatchConverter::convert(Sequence &seq, const QByteArray &data, int *returnCode)
+{
+    QByteArray result;
+    seq.loadData(data);
+    *returnCode = seq.returnCode();
+    // counted as loaded: saving may skip redundant events
+    if (m_metrics != nullptr && seq.hasSong()) {
+        m_metrics->addEvents(seq);
+    }
+    if (m_testOnly || !seq.hasSong()) {
+        return result;
+    }
+    if (m_dumpFormat.isEmpty()) {
+        result = seq.saveData();
+        if (result.isEmpty()) {
+            *returnCode = Sequence::ReturnFailure;
+        }
+    } else {
+        QBuffer buffer(&result);
+        buffer.open(QIODevice::WriteOnly);
+        bool ok;
+        if (m_dumpFormat == "columnar") {
+            ColumnarWriter writer(&buffer);
+            ok = writer.writeSequence(seq);
+        } else {
+            NdjsonWriter writer(&buffer);
+            ok = writer.writeSequence(seq);
+        }
+        if (!ok) {
+            *returnCode = Sequence::ReturnFailure;
+        }
+    }
+    return result;
+}
+
+/*
+ * Saves the results through the committer: atomic replacement of the
+ * output files, and in group mode, one synchronization for many files.
+ * With an output archive, the results are reordered as they arrive, and
+ * appended in input order.
+ */
+void BatchConverter::writeStage(BoundedQueue<Item> *input)
+{
+    Tracer::setThreadName("writer");
+    QMap<qint64, Item> pending;
+    qint64 nextIndex = 0;
+    Item item;
+    while (input->pop(item)) {
+        if (m_archive == nullptr) {
+            writeItem(item);
+            continue;
+        }
+        const qint64 index = item.index;
+        pending.insert(index, std::move(item));
+        while (!pending.isEmpty() && pending.firstKey() == nextIndex) {
+            Item ready = pending.take(nextIndex++);
+            writeItem(ready);
+            m_window.release();
+        }
+    }
+    if (!m_uncommitted.isEmpty()) {
+        commitOutputs();
+    }
+    if (m_archive != nullptr) {
+        QElapsedTimer timer;
+        timer.start();
+        Tracer::setFile(QString());
+        TraceSpan span("commit");
+        if (!m_archive->finish()) {
+            std::cerr << "cannot write archive: " << m_archive->errorString().toStdString() << std::endl;
+            m_failures++;
+        }
+        QMutexLocker locker(&m_statsMutex);
+        m_write.busyNanos += timer.nsecsElapsed();
+    }
+}
+
+/*
+ * When all the files submitted have been written, the pending group is
+ * committed, and the idle handler is called.
+ */
+void BatchConverter::writeItem(Item &item)
+{
+    if (item.completed) {
+        m_skipped++;
+    } else if (!item.marker) {
+        saveItem(item);
+    }
+    if (--m_inFlight == 0) {
+        commitOutputs();
+        if (m_idleHandler) {
+            m_idleHandler();
+        }
+    }
+}
+
+void BatchConverter::saveItem(Item &item)
+{
+    QStringList failedFiles;
+    Tracer::setFile(item.member.name);
+    TraceSpan span("write");
+    AllocStats::Scope allocScope(AllocStats::Write);
+    QElapsedTimer timer;
+    timer.start();
+    if (!m_testOnly && (item.returnCode == Sequence::ReturnSuccess ||
+                        item.returnCode == Sequence::ReturnSalvaged)) {
+        if (WRK2MID_PROBE_ENABLED(write__start)) {
+            WRK2MID_PROBE1(write__start, QFile::encodeName(item.output).constData());
+        }
+        if (m_archive != nullptr) {
+            if (!m_archive->addFile(item.entryName, item.result)) {
+                item.returnCode = Sequence::ReturnFailure;
+                item.errorClass = MetricsExporter::WriteError;
+            }
+        } else {
+            QDir().mkpath(QFileInfo(item.output).absolutePath());
+            if (!m_committer->write(item.output, item.result, &failedFiles)) {
+                std::cerr << m_committer->errorString().toStdString() << std::endl;
+                item.returnCode = Sequence::ReturnFailure;
+                item.errorClass = MetricsExporter::WriteError;
+            }
+        }
+        if (WRK2MID_PROBE_ENABLED(write__end)) {
+            WRK2MID_PROBE2(write__end, QFile::encodeName(item.output).constData(), item.result.size());
+        }
+    }
+    qint64 writeNanos = timer.nsecsElapsed();
+    addStats(m_write, writeNanos, item.result.size());
+    item.writeNanos = writeNanos;
+    item.resultSize = item.result.size();
+    item.member.data.clear();
+    item.result.clear();
+    m_uncommitted.append(std::move(item));
+    if (m_committer->pendingFiles() == 0) {
+        finishItems(failedFiles);
+    }
+}
+
+/*
+ * Makes visible the pending group of files, and counts their results.
+ */
+void BatchConverter::commitOutputs()
+{
+    QElapsedTimer timer;
+    timer.start();
+    Tracer::setFile(QString());
+    TraceSpan span("commit");
+    QStringList failedFiles;
+    if (!m_committer->commit(&failedFiles)) {
+        std::cerr << m_committer->errorString().toStdString() << std::endl;
+    }
+    finishItems(failedFiles);
+    QMutexLocker locker(&m_statsMutex);
+    m_write.busyNanos += timer.nsecsElapsed();
+    m_wallNanos = m_wall.nsecsElapsed();
+}
+
+/*
+ * Counts and journals the results of the items written since the last
+ * commit, once their outputs are visible. When the commit of a group
+ * fails, all the files of the group are lost, and each one is counted
+ * and journaled as a failure.
+ */
+void BatchConverter::finishItems(const QStringList &failedFiles)
+{
+    const QSet<QString> failed(failedFiles.cbegin(), failedFiles.cend());
+    for (Item& item : m_uncommitted) {
+        if (failed.contains(item.output) && item.returnCode != Sequence::ReturnFailure) {
+            item.returnCode = Sequence::ReturnFailure;
+            item.errorClass = MetricsExporter::CommitError;
+        }
+        switch (item.returnCode) {
+        case Sequence::ReturnSuccess:
+            break;
+        case Sequence::ReturnLimitExceeded:
+            m_limitsExceeded++;
+            break;
+        case Sequence::ReturnSalvaged:
+            m_salvaged++;
+            break;
+        default:
+            m_failures++;
+            break;
+        }
+        if (m_metrics != nullptr) {
+            const qint64 stageNanos[] = { item.readNanos, item.convertNanos, item.writeNanos };
+            m_metrics->addFile(item.returnCode, item.errorClass, item.member.size, item.resultSize, stageNanos);
+        }
+        if (m_journal != nullptr) {
+            m_journal->append({ item.member.name, item.inputHash, item.outputHash, item.returnCode,
+                                item.readNanos, item.convertNanos, item.writeNanos });
+        }
+    }
+    m_uncommitted.clear();
+    if (m_journal != nullptr && !m_journal->flush()) {
+        std::cerr << m_journal->errorString().toStdString() << std::endl;
+        m_failures++;
+    }
+}
+
+/**
+ * Prints the work done by each stage, and its utilization: the time
+ * spent working, relative to the elapsed time and the number of threads
+ * of the stage. The stage with the highest utilization is the bottleneck.
+ */
+void BatchConverter::printStats(std::ostream &out) const
+{
+    QMutexLocker locker(&m_statsMutex);
+    struct Row { const char* name; const StageStats* stats; int threads; };
+    const Row rows[] = {
+        { "read", &m_read, 1 },
+        { "convert", &m_convert, m_jobs },
+        { "write", &m_write, 1 }
+    };
+    double wall = qMax<qint64>(m_wallNanos, 1);
+    out << QString("%1 %2 %3 %4 %5\n").arg("stage", -8).arg("files", 8).arg("MiB", 10)
+           .arg("busy(s)", 10).arg("util", 7).toStdString();
+    for (const Row& row : rows) {
+        double utilization = 100.0 * row.stats->busyNanos / (wall * row.threads);
+        out << QString("%1 %2 %3 %4 %5%\n").arg(row.name, -8).arg(row.stats->items, 8)
+               .arg(row.stats->bytes / 1048576.0, 10, 'f', 2)
+               .arg(row.stats->busyNanos / 1e9, 10, 'f', 3)
+               .arg(utilization, 6, 'f', 1).toStdString();
+    }
+    out << "elapsed: " << QString::number(wall / 1e9, 'f', 3).toStdString() << " s, "
+        << m_convert.items << " files, " << m_failures << " failed, "
+        << m_skipped.load() << " skipped" << std::endl;
+    qint64 peak = MetricsExporter::peakResidentBytes();
+    if (peak >= 0) {
+        out << "peak memory: " << peak / 1024 << " KiB" << std::endl;
+    }
+#if defined(ENABLE_ALLOC_STATS)
+    AllocStats::print(out);
+#endif
+}
@@ -0,0 +1,186 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BATCHCONVERTER_H
+#define BATCHCONVERTER_H
+
+#include <atomic>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QSaveFile>
+#include <QSemaphore>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "archivereader.h"
+#include "archivewriter.h"
+#include "batchjournal.h"
+#include "boundedqueue.h"
+#include "metricsexporter.h"
+#include "outputcommitter.h"
+#include "sequence.h"
+
+class QThread;
+
+/**
+ * Pipelined conversion of many files.
+ *
+ * Three stages run concurrently, connected by bounded queues: a reader
+ * thread loads the input files (asking the kernel to prefetch the next
+ * ones) or the members of archives, a pool of workers decompresses and
+ * converts them, each one with its own Sequence,
+ * and a writer thread saves the results as they are ready, or appends them
+ * in input order to a single output archive. The time each
+ * stage spends working, not waiting on its queues, is measured to find
+ * the bottleneck.
+ *
+ * A journal records the completed inputs, which are skipped when the
+ * batch is run again. The inputs may be split in shards by a hash of
+ * their input paths (for archive members, the archive path and the
+ * member path), to convert a corpus on several machines.
+ *
+ * run() converts a list of files. Alternatively, start() keeps the
+ * pipeline running, fed by submit() with batches of files, until finish();
+ * the idle handler is called, from the writer thread, each time all the
+ * submitted files have been written and committed.
+ */
+class BatchConverter
+{
+public:
+    /**
+     * An input file and its output file name. For archives, the output
+     * is a directory, receiving the converted members in the same relative
+     * paths that they have in the archive.
+     */
+    struct FileJob {
+        QString input;
+        QString output;
+    };
+
+    BatchConverter(int jobs, std::function<void(Sequence&)> configure);
+    ~BatchConverter();
+
+    void setDumpFormat(const QString& format);
+    void setPatterns(const QStringList& include, const QStringList& exclude) { m_include = include; m_exclude = exclude; }
+    void setTestOnly(bool enable) { m_testOnly = enable; }
+    void setDurability(OutputCommitter::Durability durability) { m_durability = durability; }
+    void setOutputArchive(const QString& fileName, ArchiveWriter::Format format);
+    void setJournal(BatchJournal* journal) { m_journal = journal; }
+    void setShard(int index, int count) { m_shardIndex = index; m_shardCount = count; }
+    void setMetrics(MetricsExporter* metrics) { m_metrics = metrics; }
+    void setIdleHandler(std::function<void()> handler) { m_idleHandler = handler; }
+    int run(const QList<FileJob>& files);
+    bool start();
+    void submit(const QList<FileJob>& files);
+    int finish();
+    void printStats(std::ostream& out) const;
+
+private:
+    struct Item {
+        qint64 index;           ///< position in the input order
+        QString output;
+        QString entryName;      ///< the output name relative to the output directory
+        ArchiveMember member;   ///< the input data, and its name for messages
+        QByteArray result;
+        int returnCode;
+        int errorClass = MetricsExporter::NoError;
+        QByteArray inputHash;
+        QByteArray outputHash;
+        qint64 readNanos;
+        qint64 convertNanos;
+        qint64 writeNanos;
+        qint64 resultSize;
+        bool completed = false; ///< converted by a previous run, with the same input
+        bool marker = false;    ///< the end of a submitted batch, not a file
+    };
+    struct StageStats {
+        qint64 busyNanos = 0;
+        qint64 items = 0;
+        qint64 bytes = 0;
+    };
+
+    void readStage(BoundedQueue<Item>* output);
+    bool readFiles(const QList<FileJob>& files, BoundedQueue<Item>* output);
+    void readFile(const QString& fileName, Item& item);
+    bool readArchive(const FileJob& job, BoundedQueue<Item>* output);
+    void convertStage(BoundedQueue<Item>* input, BoundedQueue<Item>* output);
+    void writeStage(BoundedQueue<Item>* input);
+    void writeItem(Item& item);
+    void saveItem(Item& item);
+    void commitOutputs();
+    void finishItems(const QStringList& failedFiles);
+    bool pushItem(BoundedQueue<Item>* output, Item item);
+    bool isSkipped(const QString& input);
+    QString claimOutput(const QString& output, const QString& input);
+    QByteArray convert(Sequence& seq, const QByteArray& data, int* returnCode);
+    void addStats(StageStats& stage, qint64 nanos, qint64 bytes);
+
+    int m_jobs;
+    std::function<void(Sequence&)> m_configure;
+    QString m_dumpFormat;
+    QString m_suffix;
+    QStringList m_include;
+    QStringList m_exclude;
+    bool m_testOnly;
+    OutputCommitter::Durability m_durability;
+    QString m_archiveName;
+    ArchiveWriter::Format m_archiveFormat;
+    std::function<void()> m_idleHandler;
+    QMutex m_outputsMutex;
+    QHash<QString, QString> m_outputs;    ///< the input of each output name
+    QList<Item> m_uncommitted;  ///< written, waiting for the group commit
+    qint64 m_nextIndex;
+    BatchJournal* m_journal;
+    int m_shardIndex;
+    int m_shardCount;
+    MetricsExporter* m_metrics;
+    QSemaphore m_window;
+    mutable QMutex m_statsMutex;
+    StageStats m_read;
+    StageStats m_convert;
+    StageStats m_write;
+    qint64 m_wallNanos;
+    int m_failures;
+    int m_limitsExceeded;
+    int m_salvaged;
+    std::atomic<int> m_skipped;
+
+    // the running pipeline, from start() to finish()
+    std::unique_ptr<BoundedQueue<QList<FileJob>>> m_batches;
+    std::unique_ptr<BoundedQueue<Item>> m_loaded;
+    std::unique_ptr<BoundedQueue<Item>> m_converted;
+    std::unique_ptr<OutputCommitter> m_committer;
+    std::unique_ptr<ArchiveWriter> m_archive;
+    QFile m_stdoutFile;
+    QSaveFile m_archiveFile;
+    QThread* m_reader;
+    QThread* m_writer;
+    QVector<QThread*> m_workers;
+    QElapsedTimer m_wall;
+    std::atomic<qint64> m_inFlight;     ///< submitted batches and files not written yet
+};
+
+#endif // BATCHCONVERTER_H
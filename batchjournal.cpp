@@ -0,0 +1,182 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "batchjournal.h"
+#include "sequence.h"
+#if defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
+
+/**
+ * The name of a conversion status in the journal: ok, limit, salvaged or failed.
+ */
+const char* BatchJournal::statusName(int returnCode)
+{
+    switch (returnCode) {
+    case Sequence::ReturnSuccess:
+        return "ok";
+    case Sequence::ReturnLimitExceeded:
+        return "limit";
+    case Sequence::ReturnSalvaged:
+        return "salvaged";
+    default:
+        return "failed";
+    }
+}
+
+static QByteArray escapePath(const QString& path)
+{
+    QByteArray utf8 = path.toUtf8();
+    QByteArray result;
+    result.reserve(utf8.size());
+    for (char c : utf8) {
+        switch (c) {
+        case '\\':
+            result += "\\\\";
+            break;
+        case '\t':
+            result += "\\t";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        default:
+            result += c;
+        }
+    }
+    return result;
+}
+
+static QString unescapePath(const QByteArray& text)
+{
+    QByteArray result;
+    result.reserve(text.size());
+    for (int i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '\\' && i + 1 < text.size()) {
+            c = text[++i];
+            if (c == 't') {
+                c = '\t';
+            } else if (c == 'n') {
+                c = '\n';
+            }
+        }
+        result += c;
+    }
+    return QString::fromUtf8(result);
+}
+
+BatchJournal::BatchJournal(const QString &fileName) :
+    m_file(fileName),
+    m_sync(false)
+{ }
+
+/**
+ * Reads the inputs completed by previous runs, and opens the journal for
+ * appending new records. Inputs that failed are not considered completed,
+ * so they are retried, and the last record of each path wins.
+ * @return false on error.
+ */
+bool BatchJournal::open()
+{
+    QByteArray contents;
+    if (m_file.exists()) {
+        if (!m_file.open(QIODevice::ReadOnly)) {
+            m_errorString = "cannot read journal: " + m_file.fileName();
+            return false;
+        }
+        contents = m_file.readAll();
+        m_file.close();
+    }
+    int start = 0, end;
+    while ((end = contents.indexOf('\n', start)) >= 0) {
+        QByteArray line = contents.mid(start, end - start);
+        start = end + 1;
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        QList<QByteArray> fields = line.split('\t');
+        if (fields.size() != 7) {
+            continue;
+        }
+        if (fields[3] == "failed") {
+            m_completed.remove(unescapePath(fields[0]));
+        } else {
+            m_completed.insert(unescapePath(fields[0]), QByteArray::fromHex(fields[1]));
+        }
+    }
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        m_errorString = "cannot write journal: " + m_file.fileName();
+        return false;
+    }
+    if (contents.isEmpty()) {
+        m_pending = "# path\tinput_sha256\toutput_sha256\tstatus\tread_ms\tconvert_ms\twrite_ms\n";
+    } else if (!contents.endsWith('\n')) {
+        // terminate the incomplete record of an interrupted run
+        m_pending = "\n";
+    }
+    return flush();
+}
+
+/**
+ * Whether an input was completed by a previous run, and has not changed
+ * since then.
+ * @param path The input path, as recorded.
+ * @param inputHash The SHA-256 of the current contents of the input.
+ */
+bool BatchJournal::isCompleted(const QString &path, const QByteArray &inputHash) const
+{
+    auto it = m_completed.constFind(path);
+    return it != m_completed.constEnd() && !inputHash.isEmpty() && it.value() == inputHash;
+}
+
+/**
+ * Adds a record, written by the next flush().
+ */
+void BatchJournal::append(const Record &record)
+{
+    m_pending += escapePath(record.path) + '\t'
+            + record.inputHash.toHex() + '\t'
+            + record.outputHash.toHex() + '\t'
+            + statusName(record.returnCode) + '\t'
+            + QByteArray::number(record.readNanos / 1e6, 'f', 3) + '\t'
+            + QByteArray::number(record.convertNanos / 1e6, 'f', 3) + '\t'
+            + QByteArray::number(record.writeNanos / 1e6, 'f', 3) + '\n';
+}
+
+/**
+ * Writes the pending records with a single write, so a crash may only
+ * leave the last line incomplete.
+ */
+bool BatchJournal::flush()
+{
+    if (m_pending.isEmpty()) {
+        return true;
+    }
+    if (m_file.write(m_pending) != m_pending.size() || !m_file.flush()) {
+        m_errorString = "cannot write journal: " + m_file.fileName();
+        return false;
+    }
+#if defined(Q_OS_UNIX)
+    if (m_sync) {
+        ::fsync(m_file.handle());
+    }
+#endif
+    m_pending.clear();
+    return true;
+}
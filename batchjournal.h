@@ -0,0 +1,69 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BATCHJOURNAL_H
+#define BATCHJOURNAL_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+
+/**
+ * Append-only journal of a batch conversion, to resume it after a crash.
+ *
+ * Each completed input is recorded as a line of tab separated fields:
+ * the input path, the SHA-256 of the input and of the output, the status
+ * (ok, failed, limit or salvaged), and the read, convert and write times
+ * in milliseconds. Lines starting with '#' are comments, and incomplete
+ * lines left by a crash are ignored, so the journals of several runs or
+ * shards can be merged by concatenation.
+ */
+class BatchJournal
+{
+public:
+    struct Record {
+        QString path;
+        QByteArray inputHash;
+        QByteArray outputHash;
+        int returnCode;
+        qint64 readNanos;
+        qint64 convertNanos;
+        qint64 writeNanos;
+    };
+
+    explicit BatchJournal(const QString& fileName);
+
+    bool open();
+    bool isCompleted(const QString& path, const QByteArray& inputHash) const;
+    int completedCount() const { return m_completed.size(); }
+    void setSync(bool enable) { m_sync = enable; }
+    void append(const Record& record);
+    bool flush();
+    QString errorString() const { return m_errorString; }
+    static const char* statusName(int returnCode);
+
+private:
+    QFile m_file;
+    QHash<QString, QByteArray> m_completed;  ///< input hash of each completed path
+    QByteArray m_pending;
+    bool m_sync;
+    QString m_errorString;
+};
+
+#endif // BATCHJOURNAL_H
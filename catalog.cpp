@@ -0,0 +1,363 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include "catalog.h"
+#include "sequence.h"
+
+static const quint32 CATALOG_MAGIC = 0x574b4331; // "WKC1"
+static const quint32 CATALOG_VERSION = 1;
+
+static QString textOf(const QByteArray &data)
+{
+    int len = data.indexOf('\0');
+    return QString::fromLatin1(len < 0 ? data : data.left(len)).trimmed();
+}
+
+Catalog::Catalog(const QString &indexFile) :
+    m_indexFile(indexFile),
+    m_updated(0),
+    m_removed(0)
+{ }
+
+bool Catalog::load()
+{
+    m_entries.clear();
+    QFile file(m_indexFile);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::cerr << "cannot read catalog: " << m_indexFile.toStdString() << std::endl;
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+    quint32 magic, version, count;
+    stream >> magic >> version >> count;
+    if (magic != CATALOG_MAGIC || version != CATALOG_VERSION) {
+        std::cerr << "wrong catalog format: " << m_indexFile.toStdString() << std::endl;
+        return false;
+    }
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Entry entry;
+        stream >> entry;
+        m_entries.insert(entry.path, entry);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        std::cerr << "corrupted catalog: " << m_indexFile.toStdString() << std::endl;
+        m_entries.clear();
+        return false;
+    }
+    return true;
+}
+
+bool Catalog::save()
+{
+    QSaveFile file(m_indexFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        std::cerr << "cannot write catalog: " << m_indexFile.toStdString() << std::endl;
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << CATALOG_MAGIC << CATALOG_VERSION << quint32(m_entries.size());
+    for(auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        stream << it.value();
+    }
+    return stream.status() == QDataStream::Ok && file.commit();
+}
+
+int Catalog::update(const QStringList &paths, Sequence &seq)
+{
+    QSet<QString> found;
+    QStringList roots;
+    m_updated = 0;
+    m_removed = 0;
+    foreach(const QString &path, paths) {
+        QFileInfo info(path);
+        if (info.isDir()) {
+            QString root = info.canonicalFilePath();
+            roots += root + '/';
+            QDirIterator it(root, {"*.wrk"}, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                found.insert(QFileInfo(it.next()).canonicalFilePath());
+            }
+        } else if (info.isFile()) {
+            roots += info.canonicalFilePath();
+            found.insert(info.canonicalFilePath());
+        } else {
+            std::cerr << "file not found:" << path.toStdString() << std::endl;
+        }
+    }
+
+    for(auto it = m_entries.begin(); it != m_entries.end(); ) {
+        bool scanned = false;
+        foreach(const QString &root, roots) {
+            if (it.key() == root || it.key().startsWith(root)) {
+                scanned = true;
+                break;
+            }
+        }
+        if (scanned && !found.contains(it.key())) {
+            it = m_entries.erase(it);
+            ++m_removed;
+        } else {
+            ++it;
+        }
+    }
+
+    foreach(const QString &path, found) {
+        QFileInfo info(path);
+        qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+        auto it = m_entries.find(path);
+        if (it != m_entries.end() && it->size == info.size() && it->mtime == mtime) {
+            continue;
+        }
+        Entry entry;
+        entry.path = path;
+        entry.size = info.size();
+        entry.mtime = mtime;
+        scanFile(path, seq, entry);
+        m_entries.insert(path, entry);
+        ++m_updated;
+    }
+    return m_updated;
+}
+
+void Catalog::scanFile(const QString &path, Sequence &seq, Entry &entry)
+{
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        hash.addData(&file);
+        entry.hash = hash.result();
+    }
+    seq.loadFile(path);
+    entry.status = seq.returnCode();
+    entry.division = seq.getDivision();
+    entry.ticks = seq.songLengthTicks();
+    entry.events = seq.eventCount();
+    entry.variables = seq.variables();
+    entry.trackNames = seq.trackNames();
+    entry.sysexBanks = seq.sysexBanks();
+    const MeterMap& meterMap = seq.meterMap();
+    for (int i = 0; i < meterMap.timeSignatures(); ++i) {
+        MeterRec rec;
+        rec.tick = meterMap.timeSignature(i).tick;
+        rec.num = meterMap.timeSignature(i).num;
+        rec.den = meterMap.timeSignature(i).den;
+        entry.meters.append(rec);
+    }
+    const TempoMap& tempoMap = seq.tempoMap();
+    for (int i = 0; i < tempoMap.count(); ++i) {
+        TempoRec rec;
+        rec.tick = tempoMap.at(i).tick;
+        rec.tempo = tempoMap.at(i).tempo;
+        entry.tempos.append(rec);
+    }
+    entry.duration = (seq.durationMicros() + 500) / 1000;
+}
+
+QStringList Catalog::fieldValues(const Entry &entry, const QString &field)
+{
+    QStringList values;
+    if (field == "path") {
+        values += entry.path;
+    } else if (field == "hash") {
+        values += QString::fromLatin1(entry.hash.toHex());
+    } else if (field == "status") {
+        values += QString::number(entry.status);
+    } else if (field == "timebase") {
+        values += QString::number(entry.division);
+    } else if (field == "track") {
+        foreach(const QByteArray &name, entry.trackNames) {
+            values += textOf(name);
+        }
+    } else if (field == "meter") {
+        foreach(const MeterRec &rec, entry.meters) {
+            values += QString("%1/%2").arg(rec.num).arg(rec.den);
+        }
+    } else if (field == "tempo") {
+        foreach(const TempoRec &rec, entry.tempos) {
+            if (rec.tempo > 0) {
+                values += QString::number(qRound(6e7 / rec.tempo));
+            }
+        }
+    } else if (field == "sysex") {
+        for(auto it = entry.sysexBanks.cbegin(); it != entry.sysexBanks.cend(); ++it) {
+            values += QString::number(it.key());
+            if (!it.value().isEmpty()) {
+                values += it.value();
+            }
+        }
+    } else {
+        for(auto it = entry.variables.cbegin(); it != entry.variables.cend(); ++it) {
+            if (it.key().compare(field, Qt::CaseInsensitive) == 0) {
+                values += textOf(it.value());
+            }
+        }
+    }
+    values.removeDuplicates();
+    return values;
+}
+
+bool Catalog::matches(const Entry &entry, const QString &field, const QString &value)
+{
+    static const QStringList exactFields{"status", "timebase", "meter", "tempo", "sysex"};
+    bool exact = exactFields.contains(field);
+    foreach(const QString &v, fieldValues(entry, field)) {
+        if (field == "hash") {
+            if (v.startsWith(value, Qt::CaseInsensitive)) {
+                return true;
+            }
+        } else if (exact) {
+            if (v.compare(value, Qt::CaseInsensitive) == 0) {
+                return true;
+            }
+        } else if (v.contains(value, Qt::CaseInsensitive)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * The query expression is a comma separated list of field=value terms,
+ * all of them must match. Text fields (path, track, and variable records
+ * like title or author) match substrings; other fields are compared
+ * entirely. An empty expression selects the whole catalog.
+ */
+QList<const Catalog::Entry*> Catalog::query(const QString &expression, bool *ok) const
+{
+    QList<QPair<QString,QString>> terms;
+    QList<const Entry*> result;
+    foreach(const QString &term, expression.split(',', Qt::SkipEmptyParts)) {
+        int pos = term.indexOf('=');
+        if (pos < 1) {
+            std::cerr << "wrong query term: " << term.toStdString() << std::endl;
+            if (ok) {
+                *ok = false;
+            }
+            return result;
+        }
+        terms.append(qMakePair(term.left(pos).trimmed().toLower(), term.mid(pos + 1).trimmed()));
+    }
+    for(auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        bool selected = true;
+        for(const auto &term : terms) {
+            if (!matches(it.value(), term.first, term.second)) {
+                selected = false;
+                break;
+            }
+        }
+        if (selected) {
+            result.append(&it.value());
+        }
+    }
+    if (ok) {
+        *ok = true;
+    }
+    return result;
+}
+
+void Catalog::printEntries(const QList<const Entry*> &entries) const
+{
+    foreach(const Entry *entry, entries) {
+        std::cout << entry->path.toStdString() << std::endl;
+    }
+}
+
+void Catalog::printTotals(const QList<const Entry*> &entries, const QString &field) const
+{
+    QMap<QString, QPair<int, qint64>> totals;
+    foreach(const Entry *entry, entries) {
+        QStringList values = fieldValues(*entry, field.toLower());
+        if (values.isEmpty()) {
+            values += "-";
+        }
+        foreach(const QString &value, values) {
+            QPair<int, qint64> &total = totals[value];
+            total.first++;
+            total.second += entry->duration;
+        }
+    }
+    for(auto it = totals.cbegin(); it != totals.cend(); ++it) {
+        qint64 secs = it.value().second / 1000;
+        QString duration = QString("%1:%2:%3").arg(secs / 3600)
+                .arg(secs / 60 % 60, 2, 10, QChar('0'))
+                .arg(secs % 60, 2, 10, QChar('0'));
+        std::cout << it.key().toStdString() << '\t' << it.value().first
+                  << '\t' << duration.toStdString() << std::endl;
+    }
+}
+
+QDataStream &operator<<(QDataStream &stream, const Catalog::Entry &entry)
+{
+    stream << entry.path << entry.size << entry.mtime << entry.hash
+           << qint32(entry.status) << qint32(entry.division)
+           << entry.ticks << entry.duration << entry.events
+           << entry.variables << entry.trackNames << entry.sysexBanks;
+    stream << quint32(entry.tempos.size());
+    foreach(const Catalog::TempoRec &rec, entry.tempos) {
+        stream << rec.tick << rec.tempo;
+    }
+    stream << quint32(entry.meters.size());
+    foreach(const Catalog::MeterRec &rec, entry.meters) {
+        stream << rec.tick << qint32(rec.num) << qint32(rec.den);
+    }
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, Catalog::Entry &entry)
+{
+    qint32 status, division;
+    quint32 count;
+    stream >> entry.path >> entry.size >> entry.mtime >> entry.hash
+           >> status >> division
+           >> entry.ticks >> entry.duration >> entry.events
+           >> entry.variables >> entry.trackNames >> entry.sysexBanks;
+    entry.status = status;
+    entry.division = division;
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Catalog::TempoRec rec;
+        stream >> rec.tick >> rec.tempo;
+        entry.tempos.append(rec);
+    }
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Catalog::MeterRec rec;
+        qint32 num, den;
+        stream >> rec.tick >> num >> den;
+        rec.num = num;
+        rec.den = den;
+        entry.meters.append(rec);
+    }
+    return stream;
+}
@@ -0,0 +1,95 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+
+class Sequence;
+class QDataStream;
+
+/**
+ * Persistent index of WRK files metadata.
+ *
+ * The index is a single binary file, written atomically. Updating the
+ * catalog only rescans the files whose size or modification time have
+ * changed since the last run.
+ */
+class Catalog
+{
+public:
+    struct TempoRec {
+        qint64 tick;
+        qint64 tempo; ///< microseconds per quarter note
+    };
+
+    struct MeterRec {
+        qint64 tick;
+        int num;
+        int den;
+    };
+
+    struct Entry {
+        Entry(): size(0), mtime(0), status(0), division(0), ticks(0), duration(0), events(0) { }
+        QString path;
+        qint64 size;
+        qint64 mtime;
+        QByteArray hash;
+        int status;
+        int division;
+        qint64 ticks;
+        qint64 duration; ///< milliseconds
+        qint64 events;
+        QMap<QString, QByteArray> variables;
+        QMap<int, QByteArray> trackNames;
+        QMap<int, QString> sysexBanks;
+        QList<TempoRec> tempos;
+        QList<MeterRec> meters;
+    };
+
+    explicit Catalog(const QString &indexFile);
+
+    bool load();
+    bool save();
+    int update(const QStringList &paths, Sequence &seq);
+    QList<const Entry*> query(const QString &expression, bool *ok = nullptr) const;
+    void printEntries(const QList<const Entry*> &entries) const;
+    void printTotals(const QList<const Entry*> &entries, const QString &field) const;
+    int updatedCount() const { return m_updated; }
+    int removedCount() const { return m_removed; }
+
+private:
+    void scanFile(const QString &path, Sequence &seq, Entry &entry);
+    static QStringList fieldValues(const Entry &entry, const QString &field);
+    static bool matches(const Entry &entry, const QString &field, const QString &value);
+
+    QString m_indexFile;
+    QMap<QString, Entry> m_entries;
+    int m_updated;
+    int m_removed;
+};
+
+QDataStream &operator<<(QDataStream &stream, const Catalog::Entry &entry);
+QDataStream &operator>>(QDataStream &stream, Catalog::Entry &entry);
+
+#endif // CATALOG_H
@@ -0,0 +1,226 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <vector>
+#include <typeinfo>
+#include <QtEndian>
+#include "columnarwriter.h"
+#include "sequence.h"
+
+static const int ALIGNMENT = 64;
+static const int HEADER_SIZE = 64;
+static const int DIRENTRY_SIZE = 40;
+
+template<typename T> static void append(std::vector<T>& column, T value)
+{
+    column.push_back(qToLittleEndian(value));
+}
+
+static qint64 aligned(qint64 pos)
+{
+    return (pos + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+ColumnarWriter::ColumnarWriter(QIODevice *device) : m_device(device)
+{ }
+
+bool ColumnarWriter::write(const char *data, qint64 len)
+{
+    while (len > 0) {
+        qint64 written = m_device->write(data, len);
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        len -= written;
+    }
+    return true;
+}
+
+bool ColumnarWriter::writePadding(qint64 pos)
+{
+    static const char zeros[ALIGNMENT] = { 0 };
+    qint64 len = aligned(pos) - pos;
+    return write(zeros, len);
+}
+
+bool ColumnarWriter::writeSequence(const Sequence &seq)
+{
+    static const std::type_info& textId = typeid(TextEvent);
+    static const std::type_info& tempoId = typeid(TempoEvent);
+    static const std::type_info& timeSigId = typeid(TimeSignatureEvent);
+    static const std::type_info& keySigId = typeid(KeySignatureEvent);
+    static const std::type_info& sysexId = typeid(SysExEvent);
+
+    const QMap<int, EventsList>& tracks = seq.tracks();
+    quint64 rows = 0;
+    for(auto it = tracks.cbegin(); it != tracks.cend(); ++it) {
+        rows += it.value().size();
+    }
+
+    std::vector<quint32> ticks, payloadLengths;
+    std::vector<quint16> trackNums;
+    std::vector<quint8> statuses, channels, data1s, data2s;
+    std::vector<quint64> payloadOffsets;
+    std::vector<qint32> trkIds;
+    std::vector<quint64> trkFirsts, trkRows;
+    QByteArray payload;
+    ticks.reserve(rows);
+    trackNums.reserve(rows);
+    statuses.reserve(rows);
+    channels.reserve(rows);
+    data1s.reserve(rows);
+    data2s.reserve(rows);
+    payloadOffsets.reserve(rows);
+    payloadLengths.reserve(rows);
+
+    quint64 row = 0;
+    for(auto it = tracks.cbegin(); it != tracks.cend(); ++it) {
+        const EventsList& list = it.value();
+        append(trkIds, qint32(it.key()));
+        append(trkFirsts, row);
+        append(trkRows, quint64(list.size()));
+        for(auto lit = list.cbegin(); lit != list.cend(); ++lit, ++row) {
+            MIDIEvent *ev = *lit;
+            quint8 status = quint8(ev->status()), channel = 0xff, data1 = 0, data2 = 0;
+            quint64 offset = quint64(payload.size());
+            if (ev->isChannel()) {
+                channel = quint8(static_cast<ChannelEvent*>(ev)->channel());
+                switch(ev->status()) {
+                case MIDIEvent::MIDI_STATUS_NOTEOFF:
+                case MIDIEvent::MIDI_STATUS_NOTEON:
+                case MIDIEvent::MIDI_STATUS_KEYPRESURE:
+                    data1 = quint8(static_cast<KeyEvent*>(ev)->key());
+                    data2 = quint8(static_cast<KeyEvent*>(ev)->velocity());
+                    break;
+                case MIDIEvent::MIDI_STATUS_CONTROLCHANGE:
+                    data1 = quint8(static_cast<ControllerEvent*>(ev)->param());
+                    data2 = quint8(static_cast<ControllerEvent*>(ev)->value());
+                    break;
+                case MIDIEvent::MIDI_STATUS_PROGRAMCHANGE:
+                    data1 = quint8(static_cast<ProgramChangeEvent*>(ev)->program());
+                    break;
+                case MIDIEvent::MIDI_STATUS_CHANNELPRESSURE:
+                    data1 = quint8(static_cast<ChanPressEvent*>(ev)->value());
+                    break;
+                case MIDIEvent::MIDI_STATUS_PITCHBEND: {
+                        int val = 8192 + static_cast<PitchBendEvent*>(ev)->value();
+                        data1 = quint8(val % 0x80);
+                        data2 = quint8(val / 0x80);
+                    }
+                    break;
+                default:
+                    break;
+                }
+            } else if (typeid(*ev) == sysexId) {
+                status = MIDIEvent::MIDI_STATUS_SYSEX;
+                payload.append(static_cast<SysExEvent*>(ev)->data());
+            } else if (typeid(*ev) == textId) {
+                TextEvent* event = static_cast<TextEvent*>(ev);
+                status = 0xff;
+                data1 = quint8(event->textType());
+                payload.append(event->data());
+            } else if (typeid(*ev) == tempoId) {
+                quint32 tempo = quint32(qRound(static_cast<TempoEvent*>(ev)->tempo()));
+                status = 0xff;
+                data1 = 0x51;
+                payload.append(char(tempo >> 16));
+                payload.append(char(tempo >> 8));
+                payload.append(char(tempo));
+            } else if (typeid(*ev) == timeSigId) {
+                TimeSignatureEvent* event = static_cast<TimeSignatureEvent*>(ev);
+                int dd, x = event->denominator();
+                for (dd = 0; x > 1; x /= 2) {
+                    ++dd;
+                }
+                status = 0xff;
+                data1 = 0x58;
+                payload.append(char(event->numerator()));
+                payload.append(char(dd));
+                payload.append(char(24));
+                payload.append(char(8));
+            } else if (typeid(*ev) == keySigId) {
+                KeySignatureEvent* event = static_cast<KeySignatureEvent*>(ev);
+                status = 0xff;
+                data1 = 0x59;
+                payload.append(char(event->alterations()));
+                payload.append(char(event->minorMode() ? 1 : 0));
+            }
+            append(ticks, quint32(ev->tick()));
+            append(trackNums, quint16(it.key()));
+            append(statuses, status);
+            append(channels, channel);
+            append(data1s, data1);
+            append(data2s, data2);
+            append(payloadOffsets, offset);
+            append(payloadLengths, quint32(quint64(payload.size()) - offset));
+        }
+    }
+
+    const Column columns[] = {
+        { "tick", UInt32, 4, rows, reinterpret_cast<const char*>(ticks.data()) },
+        { "track", UInt16, 2, rows, reinterpret_cast<const char*>(trackNums.data()) },
+        { "status", UInt8, 1, rows, reinterpret_cast<const char*>(statuses.data()) },
+        { "channel", UInt8, 1, rows, reinterpret_cast<const char*>(channels.data()) },
+        { "data1", UInt8, 1, rows, reinterpret_cast<const char*>(data1s.data()) },
+        { "data2", UInt8, 1, rows, reinterpret_cast<const char*>(data2s.data()) },
+        { "payload_offset", UInt64, 8, rows, reinterpret_cast<const char*>(payloadOffsets.data()) },
+        { "payload_length", UInt32, 4, rows, reinterpret_cast<const char*>(payloadLengths.data()) },
+        { "trk_id", Int32, 4, quint64(trkIds.size()), reinterpret_cast<const char*>(trkIds.data()) },
+        { "trk_first", UInt64, 8, quint64(trkFirsts.size()), reinterpret_cast<const char*>(trkFirsts.data()) },
+        { "trk_rows", UInt64, 8, quint64(trkRows.size()), reinterpret_cast<const char*>(trkRows.data()) },
+        { "payload", Bytes, 1, quint64(payload.size()), payload.constData() }
+    };
+    const int columnCount = sizeof(columns) / sizeof(Column);
+
+    QByteArray header(HEADER_SIZE, '\0');
+    char *h = header.data();
+    memcpy(h, "WRKCOLS", 8);
+    qToLittleEndian<quint32>(1, h + 8);
+    qToLittleEndian<quint32>(HEADER_SIZE, h + 12);
+    qToLittleEndian<quint32>(quint32(seq.getDivision()), h + 16);
+    qToLittleEndian<quint32>(quint32(columnCount), h + 20);
+    qToLittleEndian<quint64>(rows, h + 24);
+    qToLittleEndian<quint64>(HEADER_SIZE, h + 32);
+
+    QByteArray directory(columnCount * DIRENTRY_SIZE, '\0');
+    qint64 offset = aligned(HEADER_SIZE + directory.size());
+    for (int i = 0; i < columnCount; ++i) {
+        char *d = directory.data() + i * DIRENTRY_SIZE;
+        qstrncpy(d, columns[i].name, 16);
+        d[16] = char(columns[i].type);
+        d[17] = char(columns[i].width);
+        qToLittleEndian<quint64>(columns[i].count, d + 24);
+        qToLittleEndian<quint64>(quint64(offset), d + 32);
+        offset = aligned(offset + qint64(columns[i].count) * columns[i].width);
+    }
+
+    if (!write(header.constData(), header.size()) ||
+        !write(directory.constData(), directory.size()) ||
+        !writePadding(HEADER_SIZE + directory.size())) {
+        return false;
+    }
+    for (int i = 0; i < columnCount; ++i) {
+        qint64 len = qint64(columns[i].count) * columns[i].width;
+        if (!write(columns[i].data, len) || !writePadding(len)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,83 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COLUMNARWRITER_H
+#define COLUMNARWRITER_H
+
+#include <QIODevice>
+#include <QByteArray>
+
+class Sequence;
+
+/**
+ * Exports the events of a loaded Sequence as fixed width column arrays.
+ *
+ * The container is little endian and self describing. It starts with a
+ * 64 bytes header:
+ *
+ *     char     magic[8]        "WRKCOLS\0"
+ *     uint32   version         1
+ *     uint32   headerSize      64
+ *     uint32   division        ticks per quarter note
+ *     uint32   columnCount
+ *     uint64   rowCount        number of events
+ *     uint64   directoryOffset
+ *
+ * followed by a directory of columnCount entries of 40 bytes:
+ *
+ *     char     name[16]        NUL padded column name
+ *     uint8    type            ColumnType
+ *     uint8    width           element size in bytes
+ *     uint16   reserved
+ *     uint32   reserved
+ *     uint64   count           number of elements
+ *     uint64   offset          absolute file offset, 64 bytes aligned
+ *
+ * Event columns have rowCount elements: tick, track, status, channel,
+ * data1, data2, payload_offset and payload_length. Rows are grouped by
+ * track, and sorted by tick within each track. The columns trk_id,
+ * trk_first and trk_rows describe the row range of every track.
+ * Variable length data (sysex and meta event contents) is stored in the
+ * "payload" byte column. Meta events have status 0xff, data1 is the SMF
+ * meta type, and the payload is the SMF encoding of the meta data.
+ */
+class ColumnarWriter
+{
+public:
+    enum ColumnType {
+        UInt8 = 0, UInt16 = 1, UInt32 = 2, Int32 = 3, UInt64 = 4, Int64 = 5, Bytes = 6
+    };
+
+    explicit ColumnarWriter(QIODevice *device);
+    bool writeSequence(const Sequence &seq);
+
+private:
+    struct Column {
+        const char *name;
+        ColumnType type;
+        int width;
+        quint64 count;
+        const char *data;
+    };
+    bool write(const char *data, qint64 len);
+    bool writePadding(qint64 pos);
+
+    QIODevice *m_device;
+};
+
+#endif // COLUMNARWRITER_H
@@ -0,0 +1,127 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <new>
+#include "eventpool.h"
+
+namespace {
+
+const std::size_t GRANULE = 16;
+const std::size_t CLASSES = 16;     // up to 256 bytes
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+struct ThreadPool {
+    FreeBlock* lists[CLASSES] = {};
+    qint64 usedBytes = 0;
+    qint64 freeBytes = 0;
+    qint64 peakBytes = 0;
+
+    ~ThreadPool() { trim(0); }
+
+    void trim(qint64 keepBytes)
+    {
+        for (std::size_t cls = CLASSES; cls > 0 && freeBytes > keepBytes; --cls) {
+            FreeBlock*& list = lists[cls - 1];
+            while (list != nullptr && freeBytes > keepBytes) {
+                FreeBlock* block = list;
+                list = block->next;
+                ::operator delete(block);
+                freeBytes -= cls * GRANULE;
+            }
+        }
+    }
+};
+
+thread_local ThreadPool t_pool;
+
+inline std::size_t sizeClass(std::size_t size)
+{
+    return size == 0 ? 0 : (size - 1) / GRANULE;
+}
+
+}
+
+void *EventPool::allocate(std::size_t size)
+{
+    std::size_t cls = sizeClass(size);
+    if (cls >= CLASSES) {
+        return ::operator new(size);
+    }
+    ThreadPool& pool = t_pool;
+    qint64 bytes = (cls + 1) * GRANULE;
+    pool.usedBytes += bytes;
+    pool.peakBytes = qMax(pool.peakBytes, pool.usedBytes);
+    FreeBlock* block = pool.lists[cls];
+    if (block != nullptr) {
+        pool.lists[cls] = block->next;
+        pool.freeBytes -= bytes;
+        return block;
+    }
+    return ::operator new((cls + 1) * GRANULE);
+}
+
+void EventPool::release(void *ptr, std::size_t size)
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    std::size_t cls = sizeClass(size);
+    if (cls >= CLASSES) {
+        ::operator delete(ptr);
+        return;
+    }
+    ThreadPool& pool = t_pool;
+    qint64 bytes = (cls + 1) * GRANULE;
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = pool.lists[cls];
+    pool.lists[cls] = block;
+    pool.usedBytes -= bytes;
+    pool.freeBytes += bytes;
+}
+
+/**
+ * Returns free blocks of the current thread to the system allocator,
+ * largest classes first, until at most keepBytes remain.
+ */
+void EventPool::trim(qint64 keepBytes)
+{
+    t_pool.trim(keepBytes);
+}
+
+qint64 EventPool::usedBytes()
+{
+    return t_pool.usedBytes;
+}
+
+qint64 EventPool::freeBytes()
+{
+    return t_pool.freeBytes;
+}
+
+qint64 EventPool::peakBytes()
+{
+    return t_pool.peakBytes;
+}
+
+void EventPool::resetPeak()
+{
+    t_pool.peakBytes = t_pool.usedBytes;
+}
@@ -0,0 +1,48 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EVENTPOOL_H
+#define EVENTPOOL_H
+
+#include <cstddef>
+#include <QtGlobal>
+
+/**
+ * Recycling allocator of MIDI events.
+ *
+ * Freed events are kept in per thread free lists, grouped by size
+ * classes of 16 bytes, and reused by the next allocations of the same
+ * class, so converting many files in a long running thread doesn't hit
+ * the system allocator for every event. Objects bigger than the largest
+ * class use the global allocator. The free lists are released by trim(),
+ * and when the thread ends.
+ */
+class EventPool
+{
+public:
+    static void* allocate(std::size_t size);
+    static void release(void* ptr, std::size_t size);
+    static void trim(qint64 keepBytes);
+
+    static qint64 usedBytes();
+    static qint64 freeBytes();
+    static qint64 peakBytes();
+    static void resetPeak();
+};
+
+#endif // EVENTPOOL_H
@@ -20,6 +20,7 @@
 #define EVENTS_H
 
 #include <QEvent>
+#include "eventpool.h"
 
 
 /**
@@ -48,6 +49,9 @@ public:
     virtual ~MIDIEvent() = default;
     virtual MIDIEvent *clone() { return new MIDIEvent(*this); }
 
+    static void* operator new(std::size_t size) { return EventPool::allocate(size); }
+    static void operator delete(void* ptr, std::size_t size) { EventPool::release(ptr, size); }
+
     long delta() const { return m_delta; }
     long tick() const { return m_tick; }
     void setDelta(const long delta);
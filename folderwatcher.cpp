@@ -0,0 +1,165 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+#include "folderwatcher.h"
+#if defined(Q_OS_LINUX)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FolderWatcher::FolderWatcher(const QString &path, int debounceMsecs, QObject *parent) :
+    QObject(parent),
+    m_dir(path),
+    m_fd(-1),
+    m_notifier(nullptr),
+    m_watcher(nullptr),
+    m_rescan(false)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(debounceMsecs);
+    connect(&m_timer, &QTimer::timeout, this, &FolderWatcher::flushPending);
+}
+
+FolderWatcher::~FolderWatcher()
+{
+#if defined(Q_OS_LINUX)
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+#endif
+}
+
+/**
+ * Starts watching the directory.
+ * @return false if the directory cannot be watched.
+ */
+bool FolderWatcher::start()
+{
+    if (!m_dir.exists()) {
+        m_errorString = "directory not found: " + m_dir.path();
+        return false;
+    }
+#if defined(Q_OS_LINUX)
+    m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd >= 0 && ::inotify_add_watch(m_fd, QFile::encodeName(m_dir.absolutePath()).constData(),
+                                         IN_CLOSE_WRITE | IN_MOVED_TO) >= 0) {
+        m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, &FolderWatcher::readEvents);
+        return true;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+    m_watcher = new QFileSystemWatcher(this);
+    if (!m_watcher->addPath(m_dir.absolutePath())) {
+        m_errorString = "cannot watch directory: " + m_dir.path();
+        return false;
+    }
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &FolderWatcher::directoryChanged);
+    m_snapshot.clear();
+    rescan();
+    m_pending.clear();
+    return true;
+}
+
+bool FolderWatcher::isWrkFile(const QString &fileName) const
+{
+    // hidden files are the temporary files of atomic writers
+    return !fileName.startsWith('.') && QFileInfo(fileName).suffix().compare("wrk", Qt::CaseInsensitive) == 0;
+}
+
+void FolderWatcher::addPending(const QString &fileName)
+{
+    m_pending.insert(m_dir.absoluteFilePath(fileName));
+    if (!m_timer.isActive()) {
+        m_timer.start();
+    }
+}
+
+void FolderWatcher::readEvents()
+{
+#if defined(Q_OS_LINUX)
+    alignas(struct inotify_event) char buffer[16384];
+    ssize_t len;
+    while ((len = ::read(m_fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + len; ) {
+            auto ev = reinterpret_cast<struct inotify_event*>(p);
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // events were lost: report every file
+                foreach(const QString& name, m_dir.entryList(QDir::Files)) {
+                    if (isWrkFile(name)) {
+                        addPending(name);
+                    }
+                }
+            } else if (ev->len > 0 && !(ev->mask & IN_ISDIR)) {
+                QString name = QFile::decodeName(ev->name);
+                if (isWrkFile(name)) {
+                    addPending(name);
+                }
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+#endif
+}
+
+void FolderWatcher::directoryChanged()
+{
+    m_rescan = true;
+    if (!m_timer.isActive()) {
+        m_timer.start();
+    }
+}
+
+/*
+ * Fallback without inotify: the files with a different size or time than
+ * in the previous scan are new or changed.
+ */
+void FolderWatcher::rescan()
+{
+    QHash<QString, QPair<qint64, QDateTime>> snapshot;
+    foreach(const QFileInfo& finfo, m_dir.entryInfoList(QDir::Files)) {
+        if (isWrkFile(finfo.fileName())) {
+            auto state = qMakePair(finfo.size(), finfo.lastModified());
+            snapshot.insert(finfo.fileName(), state);
+            if (m_snapshot.value(finfo.fileName()) != state) {
+                m_pending.insert(finfo.absoluteFilePath());
+            }
+        }
+    }
+    m_snapshot = snapshot;
+}
+
+void FolderWatcher::flushPending()
+{
+    if (m_rescan) {
+        m_rescan = false;
+        rescan();
+    }
+    if (!m_pending.isEmpty()) {
+        QStringList fileNames = m_pending.values();
+        fileNames.sort();
+        m_pending.clear();
+        emit filesReady(fileNames);
+    }
+}
@@ -0,0 +1,78 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FOLDERWATCHER_H
+#define FOLDERWATCHER_H
+
+#include <QDateTime>
+#include <QDir>
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+class QFileSystemWatcher;
+class QSocketNotifier;
+
+/**
+ * Watches a directory for new or changed WRK files.
+ *
+ * On Linux, inotify reports the files when they are closed after writing
+ * or renamed into the directory, so incomplete files are never reported.
+ * Elsewhere, QFileSystemWatcher reports changes of the directory, which
+ * is then rescanned comparing the size and time of its files. Events are
+ * collected for a short debounce interval, and reported together.
+ */
+class FolderWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FolderWatcher(const QString& path, int debounceMsecs = 50, QObject* parent = nullptr);
+    ~FolderWatcher();
+
+    bool start();
+    QString errorString() const { return m_errorString; }
+
+signals:
+    void filesReady(const QStringList& fileNames);
+
+private slots:
+    void readEvents();
+    void directoryChanged();
+    void flushPending();
+
+private:
+    bool isWrkFile(const QString& fileName) const;
+    void addPending(const QString& fileName);
+    void rescan();
+
+    QDir m_dir;
+    int m_fd;
+    QSocketNotifier* m_notifier;
+    QFileSystemWatcher* m_watcher;
+    QTimer m_timer;
+    QSet<QString> m_pending;
+    bool m_rescan;
+    QHash<QString, QPair<qint64, QDateTime>> m_snapshot;
+    QString m_errorString;
+};
+
+#endif // FOLDERWATCHER_H
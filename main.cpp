@@ -16,14 +16,104 @@
     along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <csignal>
 #include <iostream>
 #include <QCoreApplication>
 #include <QCommandLineParser>
+#include <QFile>
 #include <QFileInfo>
 #include <QDir>
+#include <QScopedPointer>
 #include <QVariant>
 #include <QStringList>
+#include <QThread>
+#if defined(Q_OS_UNIX)
+#include <QSocketNotifier>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 #include "sequence.h"
+#include "ndjsonwriter.h"
+#include "columnarwriter.h"
+#include "catalog.h"
+#include "archivereader.h"
+#include "batchconverter.h"
+#include "folderwatcher.h"
+#include "tracer.h"
+
+static bool parseSize(const QString& text, qint64* value)
+{
+    static const QString suffixes("KMGT");
+    QString s = text.trimmed().toUpper();
+    qint64 factor = 1;
+    if (!s.isEmpty()) {
+        int pos = suffixes.indexOf(s.back());
+        if (pos >= 0) {
+            factor = Q_INT64_C(1) << (10 * (pos + 1));
+            s.chop(1);
+        }
+    }
+    bool ok;
+    qint64 v = s.toLongLong(&ok);
+    if (ok && v >= 0) {
+        *value = v * factor;
+    }
+    return ok && v >= 0;
+}
+
+static bool parseShard(const QString& text, int* index, int* count)
+{
+    QStringList parts = text.split('/');
+    if (parts.size() != 2) {
+        return false;
+    }
+    bool ok1, ok2;
+    *index = parts[0].toInt(&ok1);
+    *count = parts[1].toInt(&ok2);
+    return ok1 && ok2 && *count > 0 && *index >= 0 && *index < *count;
+}
+
+#if defined(Q_OS_UNIX)
+static int s_quitFds[2] = { -1, -1 };
+
+static void quitSignalHandler(int)
+{
+    const char c = 1;
+    ssize_t n = ::write(s_quitFds[0], &c, sizeof(c));
+    Q_UNUSED(n)
+}
+#else
+static void quitSignalHandler(int)
+{
+    QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+}
+#endif
+
+/*
+ * Quits the event loop on SIGINT or SIGTERM, so the program ends normally,
+ * finishing the files in progress and writing the final trace and metrics.
+ * On Unix, the signal handler only writes to a socket watched by the event loop.
+ */
+static void quitOnSignals(QCoreApplication* app)
+{
+#if defined(Q_OS_UNIX)
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, s_quitFds) != 0) {
+        return;
+    }
+    QSocketNotifier* notifier = new QSocketNotifier(s_quitFds[1], QSocketNotifier::Read, app);
+    QObject::connect(notifier, &QSocketNotifier::activated, app, &QCoreApplication::quit);
+    struct sigaction action = {};
+    action.sa_handler = quitSignalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGTERM, &action, nullptr);
+#else
+    Q_UNUSED(app)
+    std::signal(SIGINT, quitSignalHandler);
+    std::signal(SIGTERM, quitSignalHandler);
+#endif
+}
 
 int main(int argc, char *argv[])
 {
@@ -49,51 +139,404 @@ int main(int argc, char *argv[])
     parser.addOption(outputOption);
     QCommandLineOption testOption({"t", "test"}, "Test only (no output)");
     parser.addOption(testOption);
-    parser.addPositionalArgument("file", "Input WRK File Name", "file");
+    QCommandLineOption dumpOption("dump", "Dump events instead of SMF output (ndjson/columnar)", "format");
+    parser.addOption(dumpOption);
+    QCommandLineOption durationOption("duration", "Print the song duration");
+    parser.addOption(durationOption);
+    QCommandLineOption indexOption("index", "Catalog index file name", "index", "wrk2mid.catalog");
+    parser.addOption(indexOption);
+    QCommandLineOption queryOption("query", "Catalog query (field=value,...)", "query");
+    parser.addOption(queryOption);
+    QCommandLineOption sumByOption("sum-by", "Catalog query: total files and duration by field", "field");
+    parser.addOption(sumByOption);
+    QCommandLineOption maxEventsOption("max-events", "Limit: number of events", "count");
+    parser.addOption(maxEventsOption);
+    QCommandLineOption maxMemoryOption("max-memory", "Limit: memory used by events (bytes, or K/M/G suffix)", "size");
+    parser.addOption(maxMemoryOption);
+    QCommandLineOption maxSysexOption("max-sysex-bytes", "Limit: length of a sysex message", "size");
+    parser.addOption(maxSysexOption);
+    QCommandLineOption maxTicksOption("max-ticks", "Limit: time of any event in ticks", "ticks");
+    parser.addOption(maxTicksOption);
+    QCommandLineOption timeoutOption("timeout", "Limit: loading time in seconds", "seconds");
+    parser.addOption(timeoutOption);
+    QCommandLineOption salvageOption("salvage", "Skip damaged chunks, saving the rest of the song");
+    parser.addOption(salvageOption);
+    QCommandLineOption optimizeOption("optimize-size", "Smaller SMF output: running status, redundant events removed");
+    parser.addOption(optimizeOption);
+    QCommandLineOption thinErrorOption("thin-error", "Thin controllers and pitch bend: maximum value error", "value");
+    parser.addOption(thinErrorOption);
+    QCommandLineOption thinSpacingOption("thin-spacing", "Thin controllers and pitch bend: minimum spacing in ticks", "ticks", "0");
+    parser.addOption(thinSpacingOption);
+    QCommandLineOption jobsOption({"j", "jobs"}, "Batch mode: number of conversion threads", "jobs");
+    parser.addOption(jobsOption);
+    QCommandLineOption outputDirOption("output-dir", "Batch mode: output directory", "dir");
+    parser.addOption(outputDirOption);
+    QCommandLineOption archiveOption("output-archive", "Batch mode: write all the outputs into one tar or zip archive (- for stdout)", "file");
+    parser.addOption(archiveOption);
+    QCommandLineOption archiveFormatOption("archive-format", "Output archive format: tar or zip (default: by file suffix)", "format");
+    parser.addOption(archiveFormatOption);
+    QCommandLineOption journalOption("journal", "Batch mode: journal of completed files, to resume an interrupted batch", "file");
+    parser.addOption(journalOption);
+    QCommandLineOption shardOption("shard", "Batch mode: convert only the shard i of N (0 <= i < N)", "i/N");
+    parser.addOption(shardOption);
+    QCommandLineOption watchOption("watch", "Watch a directory, converting new or changed files", "dir");
+    parser.addOption(watchOption);
+    QCommandLineOption traceOption("trace", "Write a Chrome trace (JSON) of the conversion phases", "file");
+    parser.addOption(traceOption);
+    QCommandLineOption statsOption("stats", "Batch mode: print statistics of the pipeline stages");
+    parser.addOption(statsOption);
+    QCommandLineOption metricsFileOption("metrics-file", "Batch mode: write metrics in the Prometheus text format", "file");
+    parser.addOption(metricsFileOption);
+    QCommandLineOption metricsIntervalOption("metrics-interval", "Batch mode: seconds between metrics updates (default: 15)", "seconds");
+    parser.addOption(metricsIntervalOption);
+    QCommandLineOption durabilityOption("durability", "Output files durability: none, file or group", "mode", "none");
+    parser.addOption(durabilityOption);
+    QCommandLineOption includeOption("include", "Archives: convert only the members matching a pattern", "glob");
+    parser.addOption(includeOption);
+    QCommandLineOption excludeOption("exclude", "Archives: skip the members matching a pattern", "glob");
+    parser.addOption(excludeOption);
+    parser.addPositionalArgument("file", "Input WRK File Name(s)", "file...");
     parser.process(app);
 
     if (parser.isSet(versionOption) || parser.isSet(helpOption)) {
         return EXIT_SUCCESS;
     }
 
+    struct TraceGuard {
+        ~TraceGuard() { Tracer::stop(); }
+    } traceGuard;
+    if (parser.isSet(traceOption)) {
+        if (!Tracer::start(parser.value(traceOption))) {
+            std::cerr << "cannot write file: " << parser.value(traceOption).toStdString() << std::endl;
+            return EXIT_FAILURE;
+        }
+        Tracer::setThreadName("main");
+    }
+
     Sequence seq;
+    int smfFormat = -1;
     if (parser.isSet(formatOption)) {
         bool ok;
         QString format = parser.value(formatOption);
         int f = format.toInt(&ok);
         if (ok && f >= 0 && f <= 1) {
-            seq.setOutputFormat(f);
+            smfFormat = f;
         } else {
             std::cerr << "wrong format: " << format.toStdString() << std::endl;
             std::cerr << parser.helpText().toStdString() << std::endl;
         }
     }
 
+    Sequence::Limits limits;
+    auto parseLimit = [&parser](const QCommandLineOption& option, qint64* value) {
+        if (parser.isSet(option) && !parseSize(parser.value(option), value)) {
+            std::cerr << "wrong limit: " << parser.value(option).toStdString() << std::endl;
+            return false;
+        }
+        return true;
+    };
+    if (!parseLimit(maxEventsOption, &limits.maxEvents) ||
+        !parseLimit(maxMemoryOption, &limits.maxMemory) ||
+        !parseLimit(maxSysexOption, &limits.maxSysexBytes) ||
+        !parseLimit(maxTicksOption, &limits.maxTicks)) {
+        return EXIT_FAILURE;
+    }
+    if (parser.isSet(timeoutOption)) {
+        bool ok;
+        double secs = parser.value(timeoutOption).toDouble(&ok);
+        if (!ok || secs < 0) {
+            std::cerr << "wrong timeout: " << parser.value(timeoutOption).toStdString() << std::endl;
+            return EXIT_FAILURE;
+        }
+        limits.timeout = qRound64(secs * 1000);
+    }
+    int thinError = -1, thinSpacing = 0;
+    if (parser.isSet(thinErrorOption) || parser.isSet(thinSpacingOption)) {
+        bool ok1 = true, ok2;
+        thinError = parser.isSet(thinErrorOption) ? parser.value(thinErrorOption).toInt(&ok1) : 0;
+        thinSpacing = parser.value(thinSpacingOption).toInt(&ok2);
+        if (!ok1 || !ok2 || thinError < 0 || thinError > 127 || thinSpacing < 0) {
+            std::cerr << "wrong thinning parameters: " << parser.value(thinErrorOption).toStdString()
+                      << " " << parser.value(thinSpacingOption).toStdString() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    const bool salvage = parser.isSet(salvageOption);
+    const bool optimizeSize = parser.isSet(optimizeOption);
+    OutputCommitter::Durability durability;
+    if (!OutputCommitter::parseDurability(parser.value(durabilityOption), &durability)) {
+        std::cerr << "wrong durability: " << parser.value(durabilityOption).toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto configure = [=](Sequence& s) {
+        QObject::connect(&s, &Sequence::message, [](const QString& text) {
+            std::cerr << text.toStdString() << std::endl;
+        });
+        if (smfFormat >= 0) {
+            s.setOutputFormat(smfFormat);
+        }
+        s.setLimits(limits);
+        s.setSalvage(salvage);
+        s.setOptimizeSize(optimizeSize);
+        s.setThinning(thinError, thinSpacing);
+        s.setDurability(durability);
+    };
+    configure(seq);
+
+    int jobs = QThread::idealThreadCount();
+    if (parser.isSet(jobsOption)) {
+        bool ok;
+        jobs = parser.value(jobsOption).toInt(&ok);
+        if (!ok || jobs < 1) {
+            std::cerr << "wrong number of jobs: " << parser.value(jobsOption).toStdString() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    QString dumpFormat;
+    if (parser.isSet(dumpOption)) {
+        dumpFormat = parser.value(dumpOption).toLower();
+        if (dumpFormat != "ndjson" && dumpFormat != "columnar") {
+            std::cerr << "wrong dump format: " << dumpFormat.toStdString() << std::endl;
+            std::cerr << parser.helpText().toStdString() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
     QStringList fileNames, positionalArgs = parser.positionalArguments();
+    if (!positionalArgs.isEmpty() && positionalArgs.first() == "catalog") {
+        Catalog catalog(parser.value(indexOption));
+        if (!catalog.load()) {
+            return EXIT_FAILURE;
+        }
+        QStringList paths = positionalArgs.mid(1);
+        if (!paths.isEmpty()) {
+            catalog.update(paths, seq);
+            if (!catalog.save()) {
+                return EXIT_FAILURE;
+            }
+            std::cerr << "catalog: " << catalog.updatedCount() << " files scanned, "
+                      << catalog.removedCount() << " removed" << std::endl;
+        }
+        if (parser.isSet(queryOption) || parser.isSet(sumByOption)) {
+            bool ok;
+            auto entries = catalog.query(parser.value(queryOption), &ok);
+            if (!ok) {
+                return EXIT_FAILURE;
+            }
+            if (parser.isSet(sumByOption)) {
+                catalog.printTotals(entries, parser.value(sumByOption));
+            } else {
+                catalog.printEntries(entries);
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+    bool batch = positionalArgs.size() > 1 || parser.isSet(outputDirOption) || parser.isSet(jobsOption)
+            || parser.isSet(archiveOption) || parser.isSet(journalOption) || parser.isSet(shardOption)
+            || parser.isSet(metricsFileOption);
+    foreach(const QString& a, positionalArgs) {
+        batch |= ArchiveReader::isArchive(a);
+    }
     foreach(const QVariant& a, positionalArgs) {
         QFileInfo f(a.toString());
         if (f.exists()) {
             fileNames += f.canonicalFilePath();
-            break;
+            if (!batch) {
+                break;
+            }
         } else {
             std::cerr << "file not found:" << f.fileName().toStdString() << std::endl;
         }
     }
 
+    const bool watch = parser.isSet(watchOption);
+    if ((batch && !fileNames.isEmpty()) || watch) {
+        QDir outputDir = QDir::current();
+        if (parser.isSet(outputDirOption)) {
+            outputDir.setPath(parser.value(outputDirOption));
+            if (!outputDir.exists() && !outputDir.mkpath(".")) {
+                std::cerr << "cannot create directory: " << outputDir.path().toStdString() << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        QString suffix = dumpFormat.isEmpty() ? ".mid" : "." + dumpFormat;
+        auto jobsFor = [&outputDir, &suffix](const QStringList& inputs) {
+            QList<BatchConverter::FileJob> files;
+            foreach(const QString& infile, inputs) {
+                if (ArchiveReader::isArchive(infile)) {
+                    files.append({ infile, outputDir.absolutePath() });
+                } else {
+                    files.append({ infile, outputDir.absoluteFilePath(QFileInfo(infile).completeBaseName() + suffix) });
+                }
+            }
+            return files;
+        };
+        BatchConverter converter(jobs, configure);
+        converter.setDumpFormat(dumpFormat);
+        converter.setPatterns(parser.values(includeOption), parser.values(excludeOption));
+        converter.setTestOnly(parser.isSet(testOption));
+        converter.setDurability(durability);
+        if (parser.isSet(archiveOption)) {
+            QString archiveName = parser.value(archiveOption);
+            ArchiveWriter::Format archiveFormat = ArchiveWriter::formatOf(archiveName);
+            if (parser.isSet(archiveFormatOption)) {
+                QString format = parser.value(archiveFormatOption).toLower();
+                if (format != "tar" && format != "zip") {
+                    std::cerr << "wrong archive format: " << format.toStdString() << std::endl;
+                    return EXIT_FAILURE;
+                }
+                archiveFormat = format == "zip" ? ArchiveWriter::Zip : ArchiveWriter::Tar;
+            }
+            converter.setOutputArchive(archiveName, archiveFormat);
+        }
+        if (parser.isSet(shardOption)) {
+            int shardIndex, shardCount;
+            if (!parseShard(parser.value(shardOption), &shardIndex, &shardCount)) {
+                std::cerr << "wrong shard: " << parser.value(shardOption).toStdString() << std::endl;
+                return EXIT_FAILURE;
+            }
+            converter.setShard(shardIndex, shardCount);
+        }
+        QScopedPointer<BatchJournal> journal;
+        if (watch && (parser.isSet(archiveOption) || parser.isSet(journalOption))) {
+            std::cerr << "the watch mode cannot be used with an output archive or a journal" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (parser.isSet(journalOption)) {
+            if (parser.isSet(archiveOption)) {
+                std::cerr << "the journal cannot be used with an output archive" << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (parser.isSet(testOption)) {
+                std::cerr << "the journal cannot be used in test mode" << std::endl;
+                return EXIT_FAILURE;
+            }
+            journal.reset(new BatchJournal(parser.value(journalOption)));
+            if (!journal->open()) {
+                std::cerr << journal->errorString().toStdString() << std::endl;
+                return EXIT_FAILURE;
+            }
+            journal->setSync(durability != OutputCommitter::DurabilityNone);
+            if (journal->completedCount() > 0) {
+                std::cerr << "resuming: " << journal->completedCount() << " files already converted, unless changed" << std::endl;
+            }
+            converter.setJournal(journal.data());
+        }
+        QScopedPointer<MetricsExporter> metrics;
+        if (parser.isSet(metricsFileOption)) {
+            double interval = 15;
+            if (parser.isSet(metricsIntervalOption)) {
+                bool ok;
+                interval = parser.value(metricsIntervalOption).toDouble(&ok);
+                if (!ok || interval <= 0 || interval > 86400) {
+                    std::cerr << "wrong metrics interval: " << parser.value(metricsIntervalOption).toStdString() << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+            metrics.reset(new MetricsExporter(parser.value(metricsFileOption)));
+            if (!metrics->start(qRound(interval * 1000))) {
+                std::cerr << metrics->errorString().toStdString() << std::endl;
+                return EXIT_FAILURE;
+            }
+            converter.setMetrics(metrics.data());
+        }
+        if (watch) {
+            FolderWatcher watcher(parser.value(watchOption));
+            if (!watcher.start()) {
+                std::cerr << watcher.errorString().toStdString() << std::endl;
+                return EXIT_FAILURE;
+            }
+            // one pipeline for the whole session, fed by the watcher
+            const bool stats = parser.isSet(statsOption);
+            MetricsExporter* exporter = metrics.data();
+            converter.setIdleHandler([&converter, exporter, stats]{
+                Tracer::flush();
+                if (exporter != nullptr) {
+                    exporter->write();
+                }
+                if (stats) {
+                    converter.printStats(std::cerr);
+                }
+            });
+            if (!converter.start()) {
+                return EXIT_FAILURE;
+            }
+            QObject::connect(&watcher, &FolderWatcher::filesReady, [&converter, &jobsFor](const QStringList& inputs) {
+                converter.submit(jobsFor(inputs));
+            });
+            // files landed while not watching: outputs missing or older than the inputs
+            QDir watchDir(parser.value(watchOption));
+            foreach(const QFileInfo& finfo, watchDir.entryInfoList({"*.wrk"}, QDir::Files)) {
+                QFileInfo output(jobsFor({ finfo.absoluteFilePath() }).first().output);
+                if (!output.exists() || output.lastModified() < finfo.lastModified()) {
+                    fileNames += finfo.absoluteFilePath();
+                }
+            }
+            if (!fileNames.isEmpty()) {
+                converter.submit(jobsFor(fileNames));
+            }
+            quitOnSignals(&app);
+            app.exec();
+            return converter.finish();
+        }
+        int rc = converter.run(jobsFor(fileNames));
+        if (parser.isSet(statsOption)) {
+            converter.printStats(std::cerr);
+        }
+        return rc;
+    }
+
     if (fileNames.isEmpty()) {
         std::cerr << "invalid arguments" << std::endl;
         std::cerr << parser.helpText().toStdString() << std::endl;
     } else {
         QString outfile, infile = fileNames.first();
+        QString suffix = dumpFormat.isEmpty() ? ".mid" : "." + dumpFormat;
         if (parser.isSet(outputOption)) {
             outfile = parser.value(outputOption);
         } else {
             QFileInfo finfo(infile);
-            outfile = QDir::current().absoluteFilePath(finfo.baseName() + ".mid");
+            outfile = QDir::current().absoluteFilePath(finfo.completeBaseName() + suffix);
         }
+        Tracer::setFile(infile);
         seq.loadFile(infile);
-        if (!parser.isSet(testOption) && seq.returnCode() == 0) {
-            seq.saveFile(outfile);
+        if (parser.isSet(durationOption) && seq.hasSong()) {
+            qint64 ms = (seq.durationMicros() + 500) / 1000;
+            QString duration = QString("%1:%2:%3.%4").arg(ms / 3600000)
+                    .arg(ms / 60000 % 60, 2, 10, QChar('0'))
+                    .arg(ms / 1000 % 60, 2, 10, QChar('0'))
+                    .arg(ms % 1000, 3, 10, QChar('0'));
+            std::cerr << "duration: " << duration.toStdString() << " (" << ms << " ms, "
+                      << seq.songLengthTicks() << " ticks, "
+                      << seq.tempoMap().count() << " tempo changes)" << std::endl;
+        }
+        if (!parser.isSet(testOption) && seq.hasSong()) {
+            if (dumpFormat.isEmpty()) {
+                seq.saveFile(outfile);
+            } else {
+                QFile out;
+                bool opened;
+                if (outfile == "-") {
+                    opened = out.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+                } else {
+                    out.setFileName(outfile);
+                    opened = out.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered);
+                }
+                bool ok = opened;
+                if (ok && dumpFormat == "columnar") {
+                    ColumnarWriter writer(&out);
+                    ok = writer.writeSequence(seq);
+                } else if (ok) {
+                    NdjsonWriter writer(&out);
+                    ok = writer.writeSequence(seq);
+                }
+                if (!ok) {
+                    std::cerr << "error writing: " << outfile.toStdString() << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
         }
         return seq.returnCode();
     }
@@ -0,0 +1,144 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include "metermap.h"
+
+MeterMap::MeterMap() : m_division(120)
+{ }
+
+void MeterMap::clear()
+{
+    m_timeSigs.clear();
+    m_keySigs.clear();
+    m_division = 120;
+}
+
+/**
+ * Adds a time signature change. The map is not usable until build() is called.
+ * @param bar Bar number.
+ * @param num Numerator.
+ * @param den Denominator, a power of two.
+ * @return false if the time signature is not valid, and was ignored.
+ */
+bool MeterMap::addTimeSignature(int bar, int num, int den)
+{
+    if (num > 0 && den > 0) {
+        m_timeSigs.append({ bar, num, den, 0 });
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Adds a key signature change. The map is not usable until build() is called.
+ * @param bar Bar number.
+ * @param alterations Number of sharps (positive) or flats (negative).
+ */
+void MeterMap::addKeySignature(int bar, int alterations)
+{
+    m_keySigs.append({ bar, alterations, 0 });
+}
+
+qint64 MeterMap::barLength(const TimeSigRec &rec) const
+{
+    return qint64(rec.num) * 4 * m_division / rec.den;
+}
+
+/**
+ * Sorts the signature changes by bar, and calculates their musical times.
+ * When several changes share the same bar, the last one wins.
+ * @param division Ticks per quarter note.
+ */
+void MeterMap::build(int division)
+{
+    m_division = division > 0 ? division : 120;
+
+    std::stable_sort(m_timeSigs.begin(), m_timeSigs.end(),
+        [](const TimeSigRec &a, const TimeSigRec &b) { return a.bar < b.bar; });
+    QVector<TimeSigRec> timeSigs;
+    timeSigs.reserve(m_timeSigs.count());
+    foreach(const TimeSigRec &rec, m_timeSigs) {
+        if (!timeSigs.isEmpty() && timeSigs.last().bar == rec.bar) {
+            timeSigs.last().num = rec.num;
+            timeSigs.last().den = rec.den;
+        } else {
+            timeSigs.append(rec);
+        }
+    }
+    for (int i = 0; i < timeSigs.count(); ++i) {
+        if (i == 0) {
+            timeSigs[i].tick = 0;
+        } else {
+            const TimeSigRec &prev = timeSigs.at(i - 1);
+            timeSigs[i].tick = prev.tick + barLength(prev) * (timeSigs.at(i).bar - prev.bar);
+        }
+    }
+    m_timeSigs = timeSigs;
+
+    std::stable_sort(m_keySigs.begin(), m_keySigs.end(),
+        [](const KeySigRec &a, const KeySigRec &b) { return a.bar < b.bar; });
+    QVector<KeySigRec> keySigs;
+    keySigs.reserve(m_keySigs.count());
+    foreach(const KeySigRec &rec, m_keySigs) {
+        if (!keySigs.isEmpty() && keySigs.last().bar == rec.bar) {
+            keySigs.last().alterations = rec.alterations;
+        } else {
+            keySigs.append(rec);
+        }
+    }
+    for (int i = 0; i < keySigs.count(); ++i) {
+        keySigs[i].tick = barToTick(keySigs.at(i).bar);
+    }
+    m_keySigs = keySigs;
+}
+
+/**
+ * Gets the musical time of the start of a bar.
+ * Before the first time signature, and without any, 4/4 is assumed.
+ * @param bar Bar number.
+ * @return Musical time in ticks, never negative.
+ */
+qint64 MeterMap::barToTick(int bar) const
+{
+    if (m_timeSigs.isEmpty() || bar < m_timeSigs.first().bar) {
+        int origin = m_timeSigs.isEmpty() ? 0 : m_timeSigs.first().bar;
+        return qMax<qint64>(0, qint64(bar - origin) * 4 * m_division);
+    }
+    auto it = std::upper_bound(m_timeSigs.cbegin(), m_timeSigs.cend(), bar,
+        [](int b, const TimeSigRec &rec) { return b < rec.bar; });
+    const TimeSigRec &rec = *(it - 1);
+    return rec.tick + barLength(rec) * (bar - rec.bar);
+}
+
+/**
+ * Gets the bar containing some musical time.
+ * @param tick Musical time.
+ * @return Bar number.
+ */
+int MeterMap::tickToBar(qint64 tick) const
+{
+    if (m_timeSigs.isEmpty()) {
+        return int(tick / (4 * m_division));
+    }
+    auto it = std::upper_bound(m_timeSigs.cbegin(), m_timeSigs.cend(), tick,
+        [](qint64 t, const TimeSigRec &rec) { return t < rec.tick; });
+    const TimeSigRec &rec = (it == m_timeSigs.cbegin()) ? *it : *(it - 1);
+    qint64 length = barLength(rec);
+    return rec.bar + int(length > 0 ? (tick - rec.tick) / length : 0);
+}
@@ -0,0 +1,70 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef METERMAP_H
+#define METERMAP_H
+
+#include <QtGlobal>
+#include <QVector>
+
+/**
+ * Meter map of a song: all the time signature and key signature changes,
+ * sorted by bar, with the musical time (ticks) of the start of each bar
+ * where they happen. Conversions between bars and ticks are O(log n).
+ *
+ * Bars are numbered as in the WRK file. The bar of the first time
+ * signature starts at tick zero.
+ */
+class MeterMap
+{
+public:
+    struct TimeSigRec {
+        int bar;
+        int num;
+        int den;
+        qint64 tick;
+    };
+
+    struct KeySigRec {
+        int bar;
+        int alterations;
+        qint64 tick;
+    };
+
+    MeterMap();
+    void clear();
+    bool addTimeSignature(int bar, int num, int den);
+    void addKeySignature(int bar, int alterations);
+    void build(int division);
+
+    qint64 barToTick(int bar) const;
+    int tickToBar(qint64 tick) const;
+    qint64 barLength(const TimeSigRec &rec) const;
+
+    int timeSignatures() const { return m_timeSigs.count(); }
+    const TimeSigRec& timeSignature(int i) const { return m_timeSigs.at(i); }
+    int keySignatures() const { return m_keySigs.count(); }
+    const KeySigRec& keySignature(int i) const { return m_keySigs.at(i); }
+
+private:
+    QVector<TimeSigRec> m_timeSigs;
+    QVector<KeySigRec> m_keySigs;
+    int m_division;
+};
+
+#endif // METERMAP_H
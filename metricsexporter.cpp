@@ -0,0 +1,345 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <iostream>
+#include <typeinfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QThread>
+#include "batchjournal.h"
+#include "events.h"
+#include "metricsexporter.h"
+#include "sequence.h"
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+/*
+ * Upper bounds of the duration buckets, in seconds: from a small file
+ * read from the page cache to a huge song on a slow disk.
+ */
+static const double BUCKET_BOUNDS[] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10
+};
+
+static const int RESULT_CODES[] = {
+    Sequence::ReturnSuccess, Sequence::ReturnFailure,
+    Sequence::ReturnLimitExceeded, Sequence::ReturnSalvaged
+};
+
+static const char* const STAGE_NAMES[] = { "read", "convert", "write" };
+
+static const char* const ERROR_NAMES[] = {
+    "", "read", "archive", "extract", "parse", "limit", "encode", "write", "commit"
+};
+
+static const char* const EVENT_NAMES[] = {
+    "note_off", "note_on", "key_pressure", "control_change", "program_change",
+    "channel_pressure", "pitch_bend", "sysex", "text", "tempo", "time_signature",
+    "key_signature", "unknown"
+};
+
+static int resultIndex(int returnCode)
+{
+    for (int i = 0; i < 4; ++i) {
+        if (RESULT_CODES[i] == returnCode) {
+            return i;
+        }
+    }
+    return 1;
+}
+
+/*
+ * The same names as the "type" key of the ndjson dump.
+ */
+static MetricsExporter::EventType eventType(MIDIEvent* ev)
+{
+    static const std::type_info& textId = typeid(TextEvent);
+    static const std::type_info& tempoId = typeid(TempoEvent);
+    static const std::type_info& timeSigId = typeid(TimeSignatureEvent);
+    static const std::type_info& keySigId = typeid(KeySignatureEvent);
+    static const std::type_info& sysexId = typeid(SysExEvent);
+
+    if (ev->isChannel()) {
+        switch (ev->status()) {
+        case MIDIEvent::MIDI_STATUS_NOTEOFF:
+            return MetricsExporter::NoteOff;
+        case MIDIEvent::MIDI_STATUS_NOTEON:
+            return MetricsExporter::NoteOn;
+        case MIDIEvent::MIDI_STATUS_KEYPRESURE:
+            return MetricsExporter::KeyPressure;
+        case MIDIEvent::MIDI_STATUS_CONTROLCHANGE:
+            return MetricsExporter::ControlChange;
+        case MIDIEvent::MIDI_STATUS_PROGRAMCHANGE:
+            return MetricsExporter::ProgramChange;
+        case MIDIEvent::MIDI_STATUS_CHANNELPRESSURE:
+            return MetricsExporter::ChannelPressure;
+        case MIDIEvent::MIDI_STATUS_PITCHBEND:
+            return MetricsExporter::PitchBend;
+        default:
+            return MetricsExporter::Unknown;
+        }
+    }
+    const std::type_info& id = typeid(*ev);
+    if (id == sysexId) {
+        return MetricsExporter::SysEx;
+    } else if (id == textId) {
+        return MetricsExporter::Text;
+    } else if (id == tempoId) {
+        return MetricsExporter::Tempo;
+    } else if (id == timeSigId) {
+        return MetricsExporter::TimeSignature;
+    } else if (id == keySigId) {
+        return MetricsExporter::KeySignature;
+    }
+    return MetricsExporter::Unknown;
+}
+
+MetricsExporter::MetricsExporter(const QString &fileName) :
+    m_fileName(fileName),
+    m_thread(nullptr),
+    m_interval(0),
+    m_stopping(false),
+    m_failing(false),
+    m_inputBytes(0),
+    m_outputBytes(0)
+{
+    std::memset(m_files, 0, sizeof(m_files));
+    std::memset(m_errors, 0, sizeof(m_errors));
+    std::memset(m_events, 0, sizeof(m_events));
+    std::memset(m_stages, 0, sizeof(m_stages));
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+/**
+ * Writes the metrics file, and then rewrites it periodically.
+ * @param intervalMillis The time between writes.
+ * @return false if the file cannot be written.
+ */
+bool MetricsExporter::start(int intervalMillis)
+{
+    if (!write()) {
+        return false;
+    }
+    m_interval = qMax(1, intervalMillis);
+    m_stopping = false;
+    m_thread = QThread::create([this]{ run(); });
+    m_thread->start();
+    return true;
+}
+
+/**
+ * Stops the periodic writes, and writes the final values.
+ */
+void MetricsExporter::stop()
+{
+    if (m_thread == nullptr) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wakeUp.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+    write();
+}
+
+void MetricsExporter::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_stopping) {
+        m_wakeUp.wait(&m_mutex, m_interval);
+        if (!m_stopping) {
+            locker.unlock();
+            write();
+            locker.relock();
+        }
+    }
+}
+
+QString MetricsExporter::errorString() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_errorString;
+}
+
+/**
+ * Sets the function returning the depths of the pipeline queues, while
+ * a batch is running. Without it, the depths are zero.
+ */
+void MetricsExporter::setQueueSampler(std::function<QueueDepths ()> sampler)
+{
+    QMutexLocker locker(&m_mutex);
+    m_sampler = sampler;
+}
+
+/**
+ * Counts a completed file.
+ * @param returnCode The conversion status.
+ * @param errorClass The ErrorClass of a file not converted.
+ * @param inputBytes The size of the input file, uncompressed.
+ * @param outputBytes The size of the output.
+ * @param stageNanos The time spent by each stage on the file.
+ */
+void MetricsExporter::addFile(int returnCode, int errorClass, qint64 inputBytes, qint64 outputBytes,
+                              const qint64 (&stageNanos)[StageCount])
+{
+    QMutexLocker locker(&m_mutex);
+    m_files[resultIndex(returnCode)]++;
+    if (errorClass > NoError && errorClass < ErrorClassCount) {
+        m_errors[errorClass]++;
+    }
+    m_inputBytes += inputBytes;
+    m_outputBytes += outputBytes;
+    for (int stage = 0; stage < StageCount; ++stage) {
+        Histogram& h = m_stages[stage];
+        double seconds = stageNanos[stage] / 1e9;
+        int bucket = 0;
+        while (bucket < BUCKETS && seconds > BUCKET_BOUNDS[bucket]) {
+            bucket++;
+        }
+        h.counts[bucket]++;
+        h.sumNanos += stageNanos[stage];
+        h.count++;
+    }
+}
+
+/**
+ * Counts the events of a loaded song, by type.
+ */
+void MetricsExporter::addEvents(const Sequence &seq)
+{
+    qint64 counts[EventTypeCount] = {};
+    foreach(const EventsList& track, seq.tracks()) {
+        foreach(MIDIEvent* ev, track) {
+            counts[eventType(ev)]++;
+        }
+    }
+    QMutexLocker locker(&m_mutex);
+    for (int type = 0; type < EventTypeCount; ++type) {
+        m_events[type] += counts[type];
+    }
+}
+
+/**
+ * The peak resident memory of the process, or -1 if it is unknown.
+ */
+qint64 MetricsExporter::peakResidentBytes()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (::getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(Q_OS_MACOS)
+        return usage.ru_maxrss;
+#else
+        return qint64(usage.ru_maxrss) * 1024;
+#endif
+    }
+#endif
+    return -1;
+}
+
+QByteArray MetricsExporter::format()
+{
+    QMutexLocker locker(&m_mutex);
+    QueueDepths depths = { 0, 0 };
+    if (m_sampler) {
+        depths = m_sampler();
+    }
+    QByteArray out;
+    out.reserve(8192);
+    auto header = [&out](const char* name, const char* type, const char* help) {
+        out += QByteArray("# HELP ") + name + ' ' + help + "\n# TYPE " + name + ' ' + type + '\n';
+    };
+
+    header("wrk2mid_files_total", "counter", "Files converted, by result.");
+    for (int i = 0; i < 4; ++i) {
+        out += QByteArray("wrk2mid_files_total{result=\"") + BatchJournal::statusName(RESULT_CODES[i])
+                + "\"} " + QByteArray::number(m_files[i]) + '\n';
+    }
+    header("wrk2mid_file_errors_total", "counter", "Files failed or exceeding a limit, by the class of error.");
+    for (int error = NoError + 1; error < ErrorClassCount; ++error) {
+        out += QByteArray("wrk2mid_file_errors_total{class=\"") + ERROR_NAMES[error] + "\"} "
+                + QByteArray::number(m_errors[error]) + '\n';
+    }
+    header("wrk2mid_input_bytes_total", "counter", "Bytes of the input files, uncompressed.");
+    out += "wrk2mid_input_bytes_total " + QByteArray::number(m_inputBytes) + '\n';
+    header("wrk2mid_output_bytes_total", "counter", "Bytes of the output files.");
+    out += "wrk2mid_output_bytes_total " + QByteArray::number(m_outputBytes) + '\n';
+    header("wrk2mid_events_total", "counter", "Events loaded, by type.");
+    for (int type = 0; type < EventTypeCount; ++type) {
+        out += QByteArray("wrk2mid_events_total{type=\"") + EVENT_NAMES[type] + "\"} "
+                + QByteArray::number(m_events[type]) + '\n';
+    }
+    header("wrk2mid_file_duration_seconds", "histogram", "Time spent on each file, by pipeline stage.");
+    for (int stage = 0; stage < StageCount; ++stage) {
+        const Histogram& h = m_stages[stage];
+        QByteArray prefix = QByteArray("wrk2mid_file_duration_seconds_bucket{stage=\"") + STAGE_NAMES[stage] + "\",le=\"";
+        qint64 cumulative = 0;
+        for (int bucket = 0; bucket <= BUCKETS; ++bucket) {
+            cumulative += h.counts[bucket];
+            out += prefix + (bucket < BUCKETS ? QByteArray::number(BUCKET_BOUNDS[bucket], 'g', 6) : QByteArray("+Inf"))
+                    + "\"} " + QByteArray::number(cumulative) + '\n';
+        }
+        out += QByteArray("wrk2mid_file_duration_seconds_sum{stage=\"") + STAGE_NAMES[stage] + "\"} "
+                + QByteArray::number(h.sumNanos / 1e9, 'f', 6) + '\n';
+        out += QByteArray("wrk2mid_file_duration_seconds_count{stage=\"") + STAGE_NAMES[stage] + "\"} "
+                + QByteArray::number(h.count) + '\n';
+    }
+    header("wrk2mid_queue_depth", "gauge", "Files waiting in the pipeline queues.");
+    out += "wrk2mid_queue_depth{queue=\"loaded\"} " + QByteArray::number(depths.loaded) + '\n';
+    out += "wrk2mid_queue_depth{queue=\"converted\"} " + QByteArray::number(depths.converted) + '\n';
+    qint64 peak = peakResidentBytes();
+    if (peak >= 0) {
+        header("wrk2mid_peak_resident_bytes", "gauge", "Peak resident memory of the process.");
+        out += "wrk2mid_peak_resident_bytes " + QByteArray::number(peak) + '\n';
+    }
+    header("wrk2mid_last_update_timestamp_seconds", "gauge", "Time of this update, to detect a stalled process.");
+    out += "wrk2mid_last_update_timestamp_seconds " + QByteArray::number(QDateTime::currentMSecsSinceEpoch() / 1000) + '\n';
+    return out;
+}
+
+/**
+ * Replaces the metrics file with the current values. Errors are reported
+ * once, until a write succeeds again.
+ */
+bool MetricsExporter::write()
+{
+    QMutexLocker writeLocker(&m_writeMutex);
+    QByteArray data = format();
+    QSaveFile file(m_fileName);
+    bool ok = file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+    QMutexLocker locker(&m_mutex);
+    if (!ok) {
+        m_errorString = QString("cannot write file: %1: %2").arg(m_fileName, file.errorString());
+        // the first write is reported by the caller of start()
+        if (!m_failing && m_interval > 0) {
+            std::cerr << m_errorString.toStdString() << std::endl;
+        }
+    }
+    m_failing = !ok;
+    return ok;
+}
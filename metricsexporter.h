@@ -0,0 +1,109 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+#include <functional>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+class QThread;
+class Sequence;
+
+/**
+ * Metrics of the batch and watch runs, exported periodically to a file
+ * in the Prometheus text format, for the textfile collector of the node
+ * exporter.
+ *
+ * The counters accumulate for the whole life of the process: files by
+ * result (ok, failed, limit or salvaged), failed files by the class of
+ * their error, input and output bytes, events by type, and histograms of the read, convert and write times of each
+ * file. The depths of the pipeline queues and the peak resident memory
+ * are sampled when the file is written. A thread writes the file at a
+ * fixed interval, replacing it atomically, so the collector never reads
+ * a partial file.
+ */
+class MetricsExporter
+{
+public:
+    enum Stage { Read, Convert, Write, StageCount };
+
+    enum EventType {
+        NoteOff, NoteOn, KeyPressure, ControlChange, ProgramChange,
+        ChannelPressure, PitchBend, SysEx, Text, Tempo, TimeSignature,
+        KeySignature, Unknown, EventTypeCount
+    };
+
+    /// Where the conversion of a file failed, or exceeded a limit
+    enum ErrorClass {
+        NoError, ReadError, ArchiveError, ExtractError, ParseError, LimitError,
+        EncodeError, WriteError, CommitError, ErrorClassCount
+    };
+
+    struct QueueDepths {
+        int loaded;     ///< files read, waiting for a worker
+        int converted;  ///< results waiting for the writer
+    };
+
+    explicit MetricsExporter(const QString& fileName);
+    ~MetricsExporter();
+
+    bool start(int intervalMillis);
+    void stop();
+    bool write();
+    QString errorString() const;
+
+    void setQueueSampler(std::function<QueueDepths()> sampler);
+    void addFile(int returnCode, int errorClass, qint64 inputBytes, qint64 outputBytes, const qint64 (&stageNanos)[StageCount]);
+    void addEvents(const Sequence& seq);
+
+    static qint64 peakResidentBytes();
+
+private:
+    static const int BUCKETS = 14;
+
+    struct Histogram {
+        qint64 counts[BUCKETS + 1];     ///< the last one is +Inf
+        qint64 sumNanos;
+        qint64 count;
+    };
+
+    QByteArray format();
+    void run();
+
+    QString m_fileName;
+    mutable QMutex m_mutex;
+    QMutex m_writeMutex;
+    QWaitCondition m_wakeUp;
+    QThread* m_thread;
+    int m_interval;
+    bool m_stopping;
+    bool m_failing;
+    QString m_errorString;
+    std::function<QueueDepths()> m_sampler;
+    qint64 m_files[4];
+    qint64 m_errors[ErrorClassCount];
+    qint64 m_inputBytes;
+    qint64 m_outputBytes;
+    qint64 m_events[EventTypeCount];
+    Histogram m_stages[StageCount];
+};
+
+#endif // METRICSEXPORTER_H
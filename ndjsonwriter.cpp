@@ -0,0 +1,240 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <typeinfo>
+#include "ndjsonwriter.h"
+#include "sequence.h"
+
+NdjsonWriter::NdjsonWriter(QIODevice *device, int bufferSize) :
+    m_device(device),
+    m_buffer(new char[bufferSize]),
+    m_size(bufferSize),
+    m_pos(0),
+    m_error(false)
+{ }
+
+NdjsonWriter::~NdjsonWriter()
+{
+    flush();
+}
+
+bool NdjsonWriter::flush()
+{
+    if (m_pos > 0 && !m_error) {
+        const char *p = m_buffer.get();
+        qint64 pending = m_pos;
+        while (pending > 0) {
+            qint64 written = m_device->write(p, pending);
+            if (written <= 0) {
+                m_error = true;
+                break;
+            }
+            p += written;
+            pending -= written;
+        }
+    }
+    m_pos = 0;
+    return !m_error;
+}
+
+void NdjsonWriter::put(const char c)
+{
+    if (m_pos == m_size) {
+        flush();
+    }
+    m_buffer[m_pos++] = c;
+}
+
+void NdjsonWriter::put(const char *s, int len)
+{
+    while (len > 0) {
+        if (m_pos == m_size) {
+            flush();
+        }
+        int n = qMin(len, m_size - m_pos);
+        std::memcpy(m_buffer.get() + m_pos, s, n);
+        m_pos += n;
+        s += n;
+        len -= n;
+    }
+}
+
+void NdjsonWriter::putInt(qint64 value)
+{
+    char digits[24];
+    int n = sizeof(digits);
+    quint64 v = value < 0 ? 0 - quint64(value) : quint64(value);
+    do {
+        digits[--n] = char('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    if (value < 0) {
+        digits[--n] = '-';
+    }
+    put(digits + n, int(sizeof(digits)) - n);
+}
+
+/*
+ * WRK texts are raw 8 bit strings, usually in a Windows codepage.
+ * They are written as Latin-1 using \u escapes for non ASCII bytes,
+ * so the output is always valid UTF-8 JSON.
+ */
+void NdjsonWriter::putString(const char *s, int len)
+{
+    static const char hex[] = "0123456789abcdef";
+    put('"');
+    for (int i = 0; i < len; ++i) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c == '"' || c == '\\') {
+            put('\\');
+            put(char(c));
+        } else if (c >= 0x20 && c < 0x80) {
+            put(char(c));
+        } else {
+            char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+            put(esc, sizeof(esc));
+        }
+    }
+    put('"');
+}
+
+void NdjsonWriter::writeEvent(int track, MIDIEvent *ev)
+{
+    static const std::type_info& textId = typeid(TextEvent);
+    static const std::type_info& tempoId = typeid(TempoEvent);
+    static const std::type_info& timeSigId = typeid(TimeSignatureEvent);
+    static const std::type_info& keySigId = typeid(KeySignatureEvent);
+    static const std::type_info& sysexId = typeid(SysExEvent);
+
+    putLiteral("{\"track\":");
+    putInt(track);
+    putLiteral(",\"tick\":");
+    putInt(ev->tick());
+    putLiteral(",\"delta\":");
+    putInt(ev->delta());
+
+    if (ev->isChannel()) {
+        ChannelEvent* chev = static_cast<ChannelEvent*>(ev);
+        int data1 = 0, data2 = -1;
+        switch(ev->status()) {
+        case MIDIEvent::MIDI_STATUS_NOTEOFF:
+            putLiteral(",\"type\":\"note_off\"");
+            data1 = static_cast<KeyEvent*>(ev)->key();
+            data2 = static_cast<KeyEvent*>(ev)->velocity();
+            break;
+        case MIDIEvent::MIDI_STATUS_NOTEON:
+            putLiteral(",\"type\":\"note_on\"");
+            data1 = static_cast<KeyEvent*>(ev)->key();
+            data2 = static_cast<KeyEvent*>(ev)->velocity();
+            break;
+        case MIDIEvent::MIDI_STATUS_KEYPRESURE:
+            putLiteral(",\"type\":\"key_pressure\"");
+            data1 = static_cast<KeyEvent*>(ev)->key();
+            data2 = static_cast<KeyEvent*>(ev)->velocity();
+            break;
+        case MIDIEvent::MIDI_STATUS_CONTROLCHANGE:
+            putLiteral(",\"type\":\"control_change\"");
+            data1 = static_cast<ControllerEvent*>(ev)->param();
+            data2 = static_cast<ControllerEvent*>(ev)->value();
+            break;
+        case MIDIEvent::MIDI_STATUS_PROGRAMCHANGE:
+            putLiteral(",\"type\":\"program_change\"");
+            data1 = static_cast<ProgramChangeEvent*>(ev)->program();
+            break;
+        case MIDIEvent::MIDI_STATUS_CHANNELPRESSURE:
+            putLiteral(",\"type\":\"channel_pressure\"");
+            data1 = static_cast<ChanPressEvent*>(ev)->value();
+            break;
+        case MIDIEvent::MIDI_STATUS_PITCHBEND: {
+                putLiteral(",\"type\":\"pitch_bend\"");
+                int val = 8192 + static_cast<PitchBendEvent*>(ev)->value();
+                data1 = val % 0x80;
+                data2 = val / 0x80;
+            }
+            break;
+        default:
+            putLiteral(",\"type\":\"unknown\"");
+            break;
+        }
+        putLiteral(",\"status\":");
+        putInt(ev->status());
+        putLiteral(",\"channel\":");
+        putInt(chev->channel());
+        putLiteral(",\"data\":[");
+        putInt(data1);
+        if (data2 >= 0) {
+            put(',');
+            putInt(data2);
+        }
+        put(']');
+    } else if (typeid(*ev) == sysexId) {
+        SysExEvent* event = static_cast<SysExEvent*>(ev);
+        const QByteArray data = event->data();
+        putLiteral(",\"type\":\"sysex\",\"status\":240,\"data\":[");
+        for (int i = 0; i < data.size(); ++i) {
+            if (i > 0) {
+                put(',');
+            }
+            putInt(static_cast<unsigned char>(data[i]));
+        }
+        put(']');
+    } else if (typeid(*ev) == textId) {
+        TextEvent* event = static_cast<TextEvent*>(ev);
+        const QByteArray data = event->data();
+        putLiteral(",\"type\":\"text\",\"status\":255,\"data\":[");
+        putInt(event->textType());
+        putLiteral("],\"text\":");
+        putString(data.constData(), data.size());
+    } else if (typeid(*ev) == tempoId) {
+        TempoEvent* event = static_cast<TempoEvent*>(ev);
+        putLiteral(",\"type\":\"tempo\",\"status\":255,\"data\":[");
+        putInt(qRound64(event->tempo()));
+        put(']');
+    } else if (typeid(*ev) == timeSigId) {
+        TimeSignatureEvent* event = static_cast<TimeSignatureEvent*>(ev);
+        putLiteral(",\"type\":\"time_signature\",\"status\":255,\"data\":[");
+        putInt(event->numerator());
+        put(',');
+        putInt(event->denominator());
+        put(']');
+    } else if (typeid(*ev) == keySigId) {
+        KeySignatureEvent* event = static_cast<KeySignatureEvent*>(ev);
+        putLiteral(",\"type\":\"key_signature\",\"status\":255,\"data\":[");
+        putInt(event->alterations());
+        put(',');
+        putInt(event->minorMode() ? 1 : 0);
+        put(']');
+    } else {
+        putLiteral(",\"type\":\"unknown\",\"status\":");
+        putInt(ev->status());
+    }
+    putLiteral("}\n");
+}
+
+bool NdjsonWriter::writeSequence(const Sequence &seq)
+{
+    const QMap<int, EventsList>& tracks = seq.tracks();
+    for(auto it = tracks.cbegin(); it != tracks.cend() && !m_error; ++it) {
+        const EventsList& list = it.value();
+        for(auto ev = list.cbegin(); ev != list.cend(); ++ev) {
+            writeEvent(it.key(), *ev);
+        }
+    }
+    return flush();
+}
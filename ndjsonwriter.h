@@ -0,0 +1,62 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NDJSONWRITER_H
+#define NDJSONWRITER_H
+
+#include <memory>
+#include <QIODevice>
+#include "events.h"
+
+class Sequence;
+
+/**
+ * Streams the events of a loaded Sequence as newline delimited JSON,
+ * one object per event, using a fixed size output buffer.
+ *
+ * Each line contains the keys: track, tick, delta, type, status,
+ * channel (only channel events), data and text (only text events).
+ * No memory is allocated while writing events; output is flushed to
+ * the device in large blocks.
+ */
+class NdjsonWriter
+{
+public:
+    explicit NdjsonWriter(QIODevice *device, int bufferSize = 1024 * 1024);
+    ~NdjsonWriter();
+
+    bool writeSequence(const Sequence &seq);
+    void writeEvent(int track, MIDIEvent *ev);
+    bool flush();
+    bool hasError() const { return m_error; }
+
+private:
+    void put(const char c);
+    void put(const char *s, int len);
+    void putInt(qint64 value);
+    void putString(const char *s, int len);
+    template<int N> void putLiteral(const char (&s)[N]) { put(s, N - 1); }
+
+    QIODevice *m_device;
+    std::unique_ptr<char[]> m_buffer;
+    int m_size;
+    int m_pos;
+    bool m_error;
+};
+
+#endif // NDJSONWRITER_H
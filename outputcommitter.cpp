@@ -0,0 +1,310 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QTemporaryFile>
+#include <QVector>
+#include "outputcommitter.h"
+#if defined(Q_OS_UNIX)
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+OutputCommitter::OutputCommitter(Durability durability, int groupFiles, qint64 groupBytes) :
+    m_durability(durability),
+    m_groupFiles(qMax(1, groupFiles)),
+    m_groupBytes(groupBytes),
+    m_pendingBytes(0)
+{
+#if defined(Q_OS_UNIX)
+    // read the umask before the first output, usually before starting threads
+    fileMode();
+#endif
+}
+
+OutputCommitter::~OutputCommitter()
+{
+    commit();
+}
+
+bool OutputCommitter::parseDurability(const QString &text, Durability *durability)
+{
+    QString s = text.trimmed().toLower();
+    if (s == "none") {
+        *durability = DurabilityNone;
+    } else if (s == "file") {
+        *durability = DurabilityFile;
+    } else if (s == "group") {
+        *durability = DurabilityGroup;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool OutputCommitter::fail(const QString &error)
+{
+    m_errorString = error;
+    return false;
+}
+
+#if defined(Q_OS_UNIX)
+
+/*
+ * Temporary files are private; the outputs get the usual permissions.
+ * The umask is read once: the only portable way to read it is setting it,
+ * which is not thread safe, so Linux reads it from /proc instead.
+ */
+int OutputCommitter::fileMode()
+{
+    static const int mode = [] {
+#if defined(Q_OS_LINUX)
+        QFile status("/proc/self/status");
+        if (status.open(QIODevice::ReadOnly)) {
+            const QList<QByteArray> lines = status.readAll().split('\n');
+            foreach(const QByteArray& line, lines) {
+                bool ok = false;
+                int mask = line.startsWith("Umask:") ? line.mid(6).trimmed().toInt(&ok, 8) : 0;
+                if (ok) {
+                    return 0666 & ~mask;
+                }
+            }
+        }
+#endif
+        mode_t mask = ::umask(0);
+        ::umask(mask);
+        return int(0666 & ~mask);
+    }();
+    return mode;
+}
+
+static bool syncPath(const QString& path, int flags)
+{
+    int fd = ::open(QFile::encodeName(path).constData(), flags);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+bool OutputCommitter::writeTemp(const QString &fileName, const QByteArray &data, bool sync, QString *tempName)
+{
+    QFileInfo finfo(fileName);
+    QTemporaryFile file(finfo.absoluteDir().filePath("." + finfo.fileName() + ".XXXXXX"));
+    file.setAutoRemove(false);
+    if (!file.open()) {
+        return fail("cannot create a temporary file for " + fileName);
+    }
+    *tempName = file.fileName();
+    bool ok = ::fchmod(file.handle(), fileMode()) == 0 &&
+            file.write(data) == data.size() && file.flush();
+    if (ok && sync) {
+        ok = ::fsync(file.handle()) == 0;
+    }
+    file.close();
+    if (!ok) {
+        QFile::remove(*tempName);
+        return fail("error writing " + fileName);
+    }
+    return true;
+}
+
+/*
+ * Synchronizes the data of the pending files. On Linux, the writeback of
+ * all the files is started first, so they are written together, and then
+ * each one is waited for with fdatasync(). Only these files are flushed,
+ * not the rest of the filesystem.
+ */
+bool OutputCommitter::syncPending()
+{
+#if defined(Q_OS_LINUX)
+    QVector<int> fds;
+    fds.reserve(m_pending.size());
+    bool ok = true;
+    foreach(const PendingFile& file, m_pending) {
+        int fd = ::open(QFile::encodeName(file.tempName).constData(), O_RDONLY);
+        if (fd < 0) {
+            ok = false;
+            break;
+        }
+        fds.append(fd);
+        ::sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+    }
+    foreach(int fd, fds) {
+        ok = ok && ::fdatasync(fd) == 0;
+        ::close(fd);
+    }
+    return ok;
+#else
+    foreach(const PendingFile& file, m_pending) {
+        if (!syncPath(file.tempName, O_RDONLY)) {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
+bool OutputCommitter::syncDirectories(const QStringList &fileNames)
+{
+    QSet<QString> dirs;
+    foreach(const QString& fileName, fileNames) {
+        dirs.insert(QFileInfo(fileName).absolutePath());
+    }
+    bool ok = true;
+    foreach(const QString& dir, dirs) {
+        ok &= syncPath(dir, O_RDONLY | O_DIRECTORY);
+    }
+    return ok;
+}
+
+/**
+ * Writes a file atomically, with the configured durability. In group
+ * mode, the write may commit the group, when it is full.
+ * @param fileName The final name of the file.
+ * @param data The file contents.
+ * @param failedFiles If not null, receives the names of the files lost by
+ * a failure: this file, or the files of a group that could not be committed.
+ * @return true on success; otherwise, see errorString().
+ */
+bool OutputCommitter::write(const QString &fileName, const QByteArray &data, QStringList *failedFiles)
+{
+    QString tempName;
+    if (!writeTemp(fileName, data, m_durability == DurabilityFile, &tempName)) {
+        if (failedFiles != nullptr) {
+            failedFiles->append(fileName);
+        }
+        return false;
+    }
+    if (m_durability == DurabilityGroup) {
+        m_pending.append({ tempName, fileName });
+        m_pendingBytes += data.size();
+        if (m_pending.size() >= m_groupFiles || m_pendingBytes >= m_groupBytes) {
+            return commit(failedFiles);
+        }
+        return true;
+    }
+    bool ok = ::rename(QFile::encodeName(tempName).constData(), QFile::encodeName(fileName).constData()) == 0;
+    if (!ok) {
+        QFile::remove(tempName);
+        fail("cannot rename the temporary file to " + fileName);
+    } else if (m_durability == DurabilityFile && !syncDirectories({ fileName })) {
+        ok = fail("cannot synchronize the directory of " + fileName);
+    }
+    if (!ok && failedFiles != nullptr) {
+        failedFiles->append(fileName);
+    }
+    return ok;
+}
+
+/**
+ * Makes visible and durable the pending group of files.
+ * @param failedFiles If not null, receives the names of the files of the
+ * group that are missing, or not durable, after a failure.
+ * @return true on success; otherwise, see errorString().
+ */
+bool OutputCommitter::commit(QStringList *failedFiles)
+{
+    if (m_pending.isEmpty()) {
+        return true;
+    }
+    QList<PendingFile> pending = m_pending;
+    m_pending.clear();
+    m_pendingBytes = 0;
+    bool ok = syncPending();
+    if (!ok) {
+        fail("cannot synchronize the output files");
+    }
+    QStringList renamed;
+    foreach(const PendingFile& file, pending) {
+        if (ok && ::rename(QFile::encodeName(file.tempName).constData(),
+                           QFile::encodeName(file.fileName).constData()) == 0) {
+            renamed.append(file.fileName);
+        } else {
+            QFile::remove(file.tempName);
+            if (ok) {
+                ok = fail("cannot commit " + file.fileName);
+            }
+            if (failedFiles != nullptr) {
+                failedFiles->append(file.fileName);
+            }
+        }
+    }
+    if (!syncDirectories(renamed)) {
+        ok = fail("cannot synchronize the output directories");
+        if (failedFiles != nullptr) {
+            failedFiles->append(renamed);
+        }
+    }
+    return ok;
+}
+
+#else
+
+/*
+ * Without POSIX rename and fsync semantics, QSaveFile provides the
+ * atomic replacement, and the three durability modes are equivalent.
+ */
+bool OutputCommitter::writeTemp(const QString &fileName, const QByteArray &data, bool sync, QString *tempName)
+{
+    Q_UNUSED(sync)
+    Q_UNUSED(tempName)
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        return fail("error writing " + fileName);
+    }
+    return true;
+}
+
+bool OutputCommitter::syncPending()
+{
+    return true;
+}
+
+bool OutputCommitter::syncDirectories(const QStringList &fileNames)
+{
+    Q_UNUSED(fileNames)
+    return true;
+}
+
+bool OutputCommitter::write(const QString &fileName, const QByteArray &data, QStringList *failedFiles)
+{
+    QString tempName;
+    if (!writeTemp(fileName, data, true, &tempName)) {
+        if (failedFiles != nullptr) {
+            failedFiles->append(fileName);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool OutputCommitter::commit(QStringList *failedFiles)
+{
+    Q_UNUSED(failedFiles)
+    return true;
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OUTPUTCOMMITTER_H
+#define OUTPUTCOMMITTER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/**
+ * Atomic creation of output files.
+ *
+ * Each file is written to a temporary file in the same directory, and
+ * then renamed to its final name, so a crash never leaves a truncated
+ * output file. The durability of the files is configurable:
+ *
+ * - None: no synchronization; the files may be lost after a system crash.
+ * - File: each file and its directory are synchronized before returning.
+ * - Group: files are renamed in groups; the data of a whole group is
+ *   synchronized at once, then the files are renamed, and finally their
+ *   directories are synchronized. Files become visible when their group
+ *   is committed, by commit() or when the group is full.
+ */
+class OutputCommitter
+{
+public:
+    enum Durability { DurabilityNone, DurabilityFile, DurabilityGroup };
+
+    explicit OutputCommitter(Durability durability = DurabilityNone,
+                             int groupFiles = 64, qint64 groupBytes = 64 * 1024 * 1024);
+    ~OutputCommitter();
+
+    bool write(const QString& fileName, const QByteArray& data, QStringList* failedFiles = nullptr);
+    bool commit(QStringList* failedFiles = nullptr);
+    int pendingFiles() const { return m_pending.size(); }
+    QString errorString() const { return m_errorString; }
+
+    static bool parseDurability(const QString& text, Durability* durability);
+
+private:
+    struct PendingFile {
+        QString tempName;
+        QString fileName;
+    };
+
+    static int fileMode();
+    bool fail(const QString& error);
+    bool writeTemp(const QString& fileName, const QByteArray& data, bool sync, QString* tempName);
+    bool syncPending();
+    bool syncDirectories(const QStringList& fileNames);
+
+    Durability m_durability;
+    int m_groupFiles;
+    qint64 m_groupBytes;
+    qint64 m_pendingBytes;
+    QList<PendingFile> m_pending;
+    QString m_errorString;
+};
+
+#endif // OUTPUTCOMMITTER_H
@@ -0,0 +1,29 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "probes.h"
+
+#if defined(ENABLE_USDT)
+/*
+ * The semaphores live in the .probes section, where the tracers find
+ * them through the notes of the probes.
+ */
+#define WRK2MID_PROBE_SEMAPHORE(name) \
+    unsigned short wrk2mid_##name##_semaphore __attribute__((used, section(".probes"))) = 0;
+WRK2MID_PROBE_NAMES(WRK2MID_PROBE_SEMAPHORE)
+#endif
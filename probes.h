@@ -0,0 +1,71 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROBES_H
+#define PROBES_H
+
+/**
+ * @file probes.h
+ * USDT (SystemTap style) static probes of the provider "wrk2mid", for
+ * perf, bpftrace or SystemTap. They are compiled only with the CMake
+ * option ENABLE_USDT; otherwise, the macros expand to nothing. A probe
+ * not attached is a single nop instruction, plus its arguments.
+ *
+ * Probes and arguments:
+ * - file__load__start(path), file__load__end(path, status)
+ * - load__start(size), load__end(status, events)
+ * - chunk(type, offset): a run of records of a WRK chunk type starts,
+ *   at that offset of the parsed stream (of the rebuilt file, when salvaging)
+ * - event(track, tick, status)
+ * - sort__start(events), sort__end(events)
+ * - encode__start(track, events), encode__end(track)
+ * - write__start(path), write__end(path, bytes)
+ *
+ * Each probe has a semaphore, incremented by the tracers attached to it,
+ * so the arguments that are costly to compute (file names, the status of
+ * each event) are guarded by WRK2MID_PROBE_ENABLED(name).
+ */
+
+#if defined(ENABLE_USDT)
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define WRK2MID_PROBE_NAMES(X) \
+    X(file__load__start) X(file__load__end) X(load__start) X(load__end) \
+    X(chunk) X(event) X(sort__start) X(sort__end) X(encode__start) \
+    X(encode__end) X(write__start) X(write__end)
+
+// the semaphores are defined once, in probes.cpp
+#define WRK2MID_PROBE_SEMAPHORE(name) extern unsigned short wrk2mid_##name##_semaphore;
+WRK2MID_PROBE_NAMES(WRK2MID_PROBE_SEMAPHORE)
+#undef WRK2MID_PROBE_SEMAPHORE
+
+#define WRK2MID_PROBE_ENABLED(name) __builtin_expect(wrk2mid_##name##_semaphore != 0, 0)
+#define WRK2MID_PROBE(name) DTRACE_PROBE(wrk2mid, name)
+#define WRK2MID_PROBE1(name, a1) DTRACE_PROBE1(wrk2mid, name, a1)
+#define WRK2MID_PROBE2(name, a1, a2) DTRACE_PROBE2(wrk2mid, name, a1, a2)
+#define WRK2MID_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(wrk2mid, name, a1, a2, a3)
+#else
+#define WRK2MID_PROBE_ENABLED(name) false
+#define WRK2MID_PROBE(name)
+#define WRK2MID_PROBE1(name, a1)
+#define WRK2MID_PROBE2(name, a1, a2)
+#define WRK2MID_PROBE3(name, a1, a2, a3)
+#endif
+
+#endif // PROBES_H
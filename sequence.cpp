@@ -16,23 +16,47 @@
     along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <iostream>
+#include <algorithm>
 #include <QtMath>
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
 #include <QFileInfo>
 #include <QRegularExpression>
+#include <QSet>
+#include <QVector>
+#include "allocstats.h"
 #include "sequence.h"
+#include "smfoptimizer.h"
+#include "probes.h"
+#include "thinning.h"
+#include "tracepoints.h"
 
 using namespace drumstick::File;
 
+// trace span names of the WRK chunk types
+static const char TRACE_HEADER[] = "load Header";
+static const char TRACE_TIMEBASE[] = "load TimeBase";
+static const char TRACE_VARS[] = "load Vars";
+static const char TRACE_TRACK[] = "load Track";
+static const char TRACE_STREAM[] = "load Stream";
+static const char TRACE_SYSEX[] = "load Sysex";
+static const char TRACE_TEMPO[] = "load Tempo";
+static const char TRACE_METER[] = "load Meter";
+static const char TRACE_COMMENTS[] = "load Comments";
+static const char TRACE_MARKERS[] = "load Markers";
+
 Sequence::Sequence(QObject *parent) : QObject(parent),
     m_smf(nullptr),
     m_wrk(nullptr),
     m_returnCode(EXIT_SUCCESS),
+    m_saveError(false),
     m_format(1),
     m_ticksDuration(0),
     m_division(-1),
     m_pos(0),
     m_curTrack(0),
+    m_cursorTrack(-1),
     m_beatMax(0),
     m_barCount(0),
     m_beatCount(0),
@@ -45,8 +69,20 @@ Sequence::Sequence(QObject *parent) : QObject(parent),
     m_lastBeat(0),
     m_beatLength(0),
     m_tick(0),
-    m_timeSignatureSet(false),
-    m_keySignatureSet(false),
+    m_eventCount(0),
+    m_memoryUsage(0),
+    m_salvage(false),
+    m_optimizeSize(false),
+    m_thinError(-1),
+    m_thinSpacing(0),
+    m_durability(OutputCommitter::DurabilityNone),
+    m_highWater(0),
+    m_listHighWater(0),
+    m_traceChunk(nullptr),
+    m_traceStart(0),
+    m_probeChunk(nullptr),
+    m_recordEnd(0),
+    m_salvageErrorPos(-1),
     m_copyrightSet(false)
 {
     m_smf = new QSmf(this);
@@ -102,6 +138,7 @@ static inline bool eventLessThan(const MIDIEvent* s1, const MIDIEvent *s2)
 void Sequence::sort(EventsList &list)
 {
     //qDebug() << Q_FUNC_INFO << "#events:" << list.count();
+    WRK2MID_PROBE1(sort__start, list.size());
     std::stable_sort(list.begin(), list.end(), eventLessThan);
     // Calculate deltas
     long lastEventTicks = 0;
@@ -109,16 +146,38 @@ void Sequence::sort(EventsList &list)
         ev->setDelta(ev->tick() - lastEventTicks);
         lastEventTicks = ev->tick();
     }
+    WRK2MID_PROBE1(sort__end, list.size());
 }
 
+/**
+ * Frees the song and all the memory retained for the next one.
+ */
 void Sequence::clear()
 {
     //qDebug() << Q_FUNC_INFO;
+    reset();
+    m_spareLists.clear();
+    m_highWater = 0;
+    m_listHighWater = 0;
+    EventPool::trim(0);
+}
+
+/**
+ * Frees the song, keeping the allocated capacity for the next one: the
+ * memory of the events, and the track lists. The capacity retained
+ * follows a high water mark of the recent songs, decaying by a quarter
+ * on each reset, so a single huge song doesn't pin its memory forever.
+ */
+void Sequence::reset()
+{
     m_lblName.clear();
     m_ticksDuration = 0;
     m_division = -1;
     m_pos = 0;
+    m_cursors.clear();
+    m_cursorTrack = -1;
     m_tempo = 500000.0;
+    m_tempoMap.clear();
     m_tick = 0;
     m_lastBeat = 0;
     m_barCount = 0;
@@ -127,22 +186,47 @@ void Sequence::clear()
     m_lowestMidiNote = 127;
     m_highestMidiNote = 0;
     m_curTrack = 0;
+    m_eventCount = 0;
+    m_memoryUsage = 0;
     m_trackMap.clear();
     m_textEvents.clear();
-    m_timeSignatureSet = false;
-    m_keySignatureSet = false;
+    m_meterMap.clear();
     m_copyrightSet = false;
     for(auto it=m_savedSysexEvents.keyBegin(); it != m_savedSysexEvents.keyEnd(); ++it) {
         delete m_savedSysexEvents[*it];
     }
     m_savedSysexEvents.clear();
-    for(auto it=m_tracksList.keyBegin(); it != m_tracksList.keyEnd(); ++it) {
-        EventsList& list = m_tracksList[*it];
-        while (!list.isEmpty()) {
-            delete list.takeFirst();
+    m_sysexBanks.clear();
+    m_variables.clear();
+    int longest = 0;
+    for(auto it = m_tracksList.cbegin(); it != m_tracksList.cend(); ++it) {
+        longest = qMax(longest, static_cast<int>(it.value().size()));
+    }
+    m_listHighWater = qMax(longest, m_listHighWater - m_listHighWater / 4);
+    for(auto it = m_tracksList.begin(); it != m_tracksList.end(); ++it) {
+        EventsList& list = it.value();
+        qDeleteAll(list);
+        if (list.size() <= m_listHighWater && m_spareLists.size() < MAX_SPARE_LISTS) {
+            list.erase(list.begin(), list.end());
+            m_spareLists.append(std::move(list));
         }
     }
     m_tracksList.clear();
+    m_highWater = qMax(EventPool::peakBytes(), m_highWater - m_highWater / 4);
+    EventPool::trim(m_highWater);
+    EventPool::resetPeak();
+}
+
+/*
+ * The events list of a track, created on first use from the spare lists.
+ */
+EventsList& Sequence::trackEvents(int track)
+{
+    auto it = m_tracksList.find(track);
+    if (it == m_tracksList.end()) {
+        it = m_tracksList.insert(track, m_spareLists.isEmpty() ? EventsList() : m_spareLists.takeLast());
+    }
+    return it.value();
 }
 
 bool Sequence::isEmpty()
@@ -159,49 +243,443 @@ void Sequence::loadPattern(QList<MIDIEvent*> pattern)
 {
     clear();
     m_tracksList[0] = pattern;
+    rewind();
 }
 
 void Sequence::loadFile(const QString& fileName)
 {
+    m_messages.clear();
     QFileInfo finfo(fileName);
     if (finfo.exists()) {
-        clear();
-        try {
-            emit loadingStart(finfo.size());
-            QString ext = finfo.suffix().toLower();
-            if (ext == "wrk") {
-                m_wrk->readFromFile(fileName);
-            } else {
-                std::cerr << "wrong file type" << std::endl;
-                m_returnCode = EXIT_FAILURE;
-                return;
-            }
-            emit loadingFinished();
-            for(auto it=m_tracksList.keyBegin(); it!=m_tracksList.keyEnd(); ++it) {
-                EventsList& list = m_tracksList[*it];
-                //qDebug() << "track:" << *it;
-                if (!list.isEmpty()) {
-                    sort(list);
-                }
-            }
+        if (finfo.suffix().toLower() != "wrk") {
+            clear();
+            report("wrong file type");
+            m_returnCode = EXIT_FAILURE;
+            return;
+        }
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+            clear();
+            report("cannot read file");
+            m_returnCode = EXIT_FAILURE;
+            return;
+        }
+        if (WRK2MID_PROBE_ENABLED(file__load__start)) {
+            WRK2MID_PROBE1(file__load__start, QFile::encodeName(fileName).constData());
+        }
+        loadStream(&file);
+        if (WRK2MID_PROBE_ENABLED(file__load__end)) {
+            WRK2MID_PROBE2(file__load__end, QFile::encodeName(fileName).constData(), m_returnCode);
+        }
+        if (hasSong()) {
             m_lblName = finfo.fileName();
             m_currentFile = finfo.fileName();
+        }
+    }
+}
+
+/**
+ * Loads a WRK song from memory, without any filesystem access.
+ * Raw memory can be wrapped without copying using QByteArray::fromRawData().
+ * @param data The contents of a WRK file.
+ */
+void Sequence::loadData(const QByteArray& data)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    loadStream(&buffer);
+}
+
+/*
+ * Reads a sequential device until its end, or until it exceeds the limit,
+ * in blocks, so a huge limit is not allocated up front.
+ */
+static QByteArray readSequential(QIODevice* device, qint64 limit)
+{
+    QByteArray data;
+    while (limit <= 0 || data.size() <= limit) {
+        QByteArray block = device->read(65536);
+        if (block.isEmpty() && !device->waitForReadyRead(-1)) {
+            break;
+        }
+        data.append(block);
+    }
+    return data;
+}
+
+/**
+ * Loads a WRK song from an open device. The parser seeks while reading,
+ * so sequential devices (pipes, sockets, the standard input) are read
+ * into memory until their end first.
+ * The result is available from returnCode() and hasSong().
+ * @param device A readable device, positioned at the WRK header.
+ */
+void Sequence::loadStream(QIODevice* device)
+{
+    TraceSpan span("load");
+    AllocStats::Scope allocScope(AllocStats::Load);
+    reset();
+    m_returnCode = EXIT_SUCCESS;
+    m_skipped.clear();
+    m_messages.clear();
+    m_loadTimer.start();
+    m_traceChunk = nullptr;
+    m_probeChunk = nullptr;
+    traceChunk(TRACE_HEADER);
+    QBuffer buffer;
+    try {
+        if (device->isSequential()) {
+            buffer.setData(readSequential(device, m_limits.maxMemory));
+            buffer.open(QIODevice::ReadOnly);
+            device = &buffer;
+        }
+        qint64 size = device->size() - device->pos();
+        if (m_limits.maxMemory > 0 && size > m_limits.maxMemory) {
+            throw LimitExceededError("file size exceeds the memory limit");
+        }
+        WRK2MID_PROBE1(load__start, size);
+        emit loadingStart(size);
+        if (m_salvage) {
+            salvageData(device->readAll());
+        } else {
+            QDataStream stream(device);
+            m_wrk->readFromStream(&stream);
+        }
+        traceChunk(nullptr);
+        emit loadingFinished();
+        appendMeterEvents();
+        for(auto it=m_tracksList.keyBegin(); it!=m_tracksList.keyEnd(); ++it) {
+            EventsList& list = m_tracksList[*it];
+            //qDebug() << "track:" << *it;
+            if (!list.isEmpty()) {
+                TraceSpan sortSpan("sort", *it);
+                AllocStats::Scope sortScope(AllocStats::Sort);
+                sort(list);
+            }
+        }
+        m_tempoMap.build(m_division);
+        updateTempo(m_tempoMap.tempoAt(0));
+        if (m_thinError >= 0) {
+            thinControllers();
+        }
+        rewind();
+    } catch (const LimitExceededError& e) {
+        m_returnCode = ReturnLimitExceeded;
+        report(QString("limit exceeded: %1").arg(e.what()));
+        reset();
+    } catch (...) {
+        m_returnCode = EXIT_FAILURE;
+        report("corrupted file");
+        reset();
+    }
+    traceChunk(nullptr);
+    WRK2MID_PROBE2(load__end, m_returnCode, m_eventCount);
+}
+
+/*
+ * Traces the parsing of the WRK chunks. Drumstick reports the records of
+ * each chunk while parsing it, so a span (and the chunk probe) covers a
+ * run of records of the same chunk type, until the next type starts.
+ * A null chunk ends it.
+ */
+void Sequence::traceChunk(const char *chunk)
+{
+    // the first call, from loadStream(), is before the parser has a stream
+    if (WRK2MID_PROBE_ENABLED(chunk) && chunk != nullptr && m_traceChunk != nullptr) {
+        probeChunk(chunk);
+    }
+    if (chunk == m_traceChunk) {
+        return;
+    }
+    TraceSink* sink = TraceSink::current();
+    if (sink != nullptr) {
+        qint64 now = sink->now();
+        if (m_traceChunk != nullptr) {
+            sink->complete(m_traceChunk, m_traceStart, now, -1);
+        }
+        m_traceStart = now;
+    }
+    m_traceChunk = chunk;
+}
+
+/*
+ * Drumstick reports each record after reading it, so a run of records
+ * starts where the previous record ended (including the chunks that are
+ * not reported, like unknown ones), and the header at the start.
+ */
+void Sequence::probeChunk(const char *chunk)
+{
+    if (chunk != m_probeChunk) {
+        qint64 offset = chunk == TRACE_HEADER ? 0 : m_recordEnd;
+        WRK2MID_PROBE2(chunk, chunk, offset);
+        m_probeChunk = chunk;
+    }
+    m_recordEnd = m_wrk->getFilePos();
+}
+
+/*
+ * Loads a damaged song, skipping malformed chunks. First, the chunk
+ * structure is checked using the length prefixes, and the areas that
+ * can't be framed are skipped. If the parser still fails on some chunk,
+ * the song is loaded again without it. The ranges of bytes skipped are
+ * reported, and the song keeps everything else.
+ */
+void Sequence::salvageData(const QByteArray& data)
+{
+    QList<WrkChunkInfo> chunks;
+    if (!scanWrkChunks(data, chunks, m_skipped)) {
+        report("invalid file format");
+        m_returnCode = EXIT_FAILURE;
+        return;
+    }
+    bool recovered = true;
+    forever {
+        QList<qint64> offsets;
+        QByteArray wrk = buildWrkFile(data, chunks, offsets);
+        QBuffer buffer(&wrk);
+        buffer.open(QIODevice::ReadOnly);
+        QDataStream stream(&buffer);
+        m_salvageErrorPos = -1;
+        try {
+            m_wrk->readFromStream(&stream);
+        } catch (const LimitExceededError&) {
+            throw;
         } catch (...) {
-            m_returnCode = EXIT_FAILURE;
-            std::cerr << "corrupted file" << std::endl;
-            clear();
+            m_salvageErrorPos = m_wrk->getFilePos();
+        }
+        if (m_salvageErrorPos < 0) {
+            break;
         }
+        int bad = -1;
+        for (int i = 0; i < chunks.count(); ++i) {
+            if (offsets[i] < m_salvageErrorPos &&
+                m_salvageErrorPos <= offsets[i] + WRK_CHUNK_PREFIX + chunks[i].length) {
+                bad = i;
+                break;
+            }
+        }
+        if (bad < 0) {
+            recovered = false;
+            break;
+        }
+        m_skipped.append({ chunks[bad].offset, WRK_CHUNK_PREFIX + chunks[bad].length });
+        chunks.removeAt(bad);
+        reset();
+    }
+    std::sort(m_skipped.begin(), m_skipped.end(),
+        [](const ByteRange& a, const ByteRange& b) { return a.offset < b.offset; });
+    foreach(const ByteRange& range, m_skipped) {
+        report(QString("skipped bytes %1-%2 (%3 bytes)").arg(range.offset)
+               .arg(range.offset + range.length - 1).arg(range.length));
+    }
+    if (!recovered) {
+        report("unrecoverable error, keeping the events loaded so far");
+    }
+    if (!m_skipped.isEmpty() || !recovered) {
+        m_returnCode = ReturnSalvaged;
     }
 }
 
+/**
+ * Writes the loaded song as a SMF file. The file is replaced atomically,
+ * with the durability set by setDurability().
+ */
 void Sequence::saveFile(const QString& fileName)
 {
+    TraceSpan span("write");
+    QByteArray smf = saveData();
+    AllocStats::Scope allocScope(AllocStats::Write);
+    OutputCommitter committer(m_durability);
+    if (WRK2MID_PROBE_ENABLED(write__start)) {
+        WRK2MID_PROBE1(write__start, QFile::encodeName(fileName).constData());
+    }
+    if (smf.isEmpty() || !committer.write(fileName, smf) || !committer.commit()) {
+        report("error writing: " + fileName);
+        m_returnCode = EXIT_FAILURE;
+    }
+    if (WRK2MID_PROBE_ENABLED(write__end)) {
+        WRK2MID_PROBE2(write__end, QFile::encodeName(fileName).constData(), smf.size());
+    }
+}
+
+/**
+ * Converts the loaded song into a SMF in memory.
+ * @return The SMF contents, or an empty array on error.
+ */
+QByteArray Sequence::saveData()
+{
+    QByteArray smf;
+    QBuffer buffer(&smf);
+    buffer.open(QIODevice::WriteOnly);
+    if (!saveStream(&buffer)) {
+        smf.clear();
+    }
+    return smf;
+}
+
+/**
+ * Writes the loaded song as a SMF to an open device. The writer seeks
+ * back to patch the length of each track, so for sequential devices
+ * (pipes, sockets, the standard output) the SMF is built in memory first.
+ * @param device A writable device.
+ * @return true on success.
+ */
+bool Sequence::saveStream(QIODevice* device)
+{
+    TraceSpan span("save");
+    AllocStats::Scope allocScope(AllocStats::Encode);
     int tracks = m_format == 0 ? 1 : m_tracksList.size();
-    //qDebug() << Q_FUNC_INFO << fileName << "tracks:" << tracks << m_tracksList.keys();
+    //qDebug() << Q_FUNC_INFO << "tracks:" << tracks << m_tracksList.keys();
     m_smf->setDivision(m_division);
     m_smf->setFileFormat(m_format);
     m_smf->setTracks(tracks);
-    m_smf->writeToFile(fileName);
+    m_saveError = false;
+    // the song is not modified: the redundant events are skipped while encoding
+    m_redundant = m_optimizeSize ? redundantEvents() : QSet<MIDIEvent*>();
+    if (m_optimizeSize || device->isSequential()) {
+        QByteArray smf;
+        QBuffer buffer(&smf);
+        buffer.open(QIODevice::WriteOnly);
+        QDataStream stream(&buffer);
+        m_smf->writeToStream(&stream);
+        buffer.close();
+        if (!m_saveError) {
+            if (m_optimizeSize) {
+                smf = optimizeSmfEncoding(smf);
+            }
+            m_saveError = device->write(smf) != smf.size();
+        }
+    } else {
+        QDataStream stream(device);
+        m_smf->writeToStream(&stream);
+        m_saveError |= stream.status() != QDataStream::Ok;
+    }
+    m_redundant.clear();
+    return !m_saveError;
+}
+
+/*
+ * Lossy simplification of the controller and pitch bend curves of all
+ * the tracks, within the maximum error and minimum spacing given by
+ * setThinning(). The reduction is reported to the standard error.
+ */
+void Sequence::thinControllers()
+{
+    TraceSpan span("thin");
+    AllocStats::Scope allocScope(AllocStats::Thin);
+    ControllerThinner thinner(m_thinError, m_thinSpacing);
+    for(auto it = m_tracksList.begin(); it != m_tracksList.end(); ++it) {
+        EventsList& list = it.value();
+        if (thinner.thin(list)) {
+            long lastEventTicks = 0;
+            foreach(MIDIEvent* ev, list) {
+                ev->setDelta(ev->tick() - lastEventTicks);
+                lastEventTicks = ev->tick();
+            }
+        }
+    }
+    if (thinner.inputEvents() > 0) {
+        report(QString("thinning: %1 of %2 controller events kept (%3%)").arg(thinner.outputEvents())
+               .arg(thinner.inputEvents()).arg(qRound(100.0 * thinner.outputEvents() / thinner.inputEvents())));
+    }
+}
+
+/*
+ * Finds the events that don't change the state of the receiver:
+ * controllers and programs repeating the last value sent to the same
+ * channel of the same port, in any track (tracks with a forced port
+ * drive another device), and identical sysex messages at the same time
+ * in the same track. Data entry, increment/decrement and channel mode
+ * controllers are never removed. A program is not redundant after a
+ * bank select change.
+ */
+QSet<MIDIEvent*> Sequence::redundantEvents() const
+{
+    struct EventRef {
+        long tick;
+        int port;
+        MIDIEvent* ev;
+    };
+    struct PortState {
+        PortState()
+        {
+            std::fill(&controllers[0][0], &controllers[0][0] + 16 * 128, -1);
+            std::fill(programs, programs + 16, -1);
+        }
+        int controllers[16][128];
+        int programs[16];
+    };
+    QVector<EventRef> refs;
+    for(auto it = m_tracksList.cbegin(); it != m_tracksList.cend(); ++it) {
+        // the single track of format 0 has no forced port
+        int port = m_format == 0 ? -1 : m_trackMap.value(it.key()).port;
+        foreach(MIDIEvent* ev, it.value()) {
+            if (ev->isChannel() && (ev->status() == MIDIEvent::MIDI_STATUS_CONTROLCHANGE ||
+                                    ev->status() == MIDIEvent::MIDI_STATUS_PROGRAMCHANGE)) {
+                refs.append({ ev->tick(), port, ev });
+            }
+        }
+    }
+    std::stable_sort(refs.begin(), refs.end(),
+        [](const EventRef& a, const EventRef& b) { return a.tick < b.tick; });
+
+    QMap<int, PortState> ports;
+    QSet<MIDIEvent*> redundant;
+    foreach(const EventRef& ref, refs) {
+        PortState& state = ports[ref.port];
+        int (&controllers)[16][128] = state.controllers;
+        int (&programs)[16] = state.programs;
+        int chan = static_cast<ChannelEvent*>(ref.ev)->channel();
+        if (ref.ev->status() == MIDIEvent::MIDI_STATUS_CONTROLCHANGE) {
+            ControllerEvent* ev = static_cast<ControllerEvent*>(ref.ev);
+            int param = ev->param() & 0x7f;
+            if (param == ControllerEvent::MIDI_CTL_MSB_DATA_ENTRY ||
+                param == ControllerEvent::MIDI_CTL_LSB_DATA_ENTRY ||
+                param == ControllerEvent::MIDI_CTL_DATA_INCREMENT ||
+                param == ControllerEvent::MIDI_CTL_DATA_DECREMENT ||
+                param >= ControllerEvent::MIDI_CTL_ALL_SOUNDS_OFF) {
+                continue;
+            }
+            if (controllers[chan][param] == ev->value()) {
+                redundant.insert(ev);
+            } else {
+                controllers[chan][param] = ev->value();
+                if (param == ControllerEvent::MIDI_CTL_MSB_BANK ||
+                    param == ControllerEvent::MIDI_CTL_LSB_BANK) {
+                    programs[chan] = -1;
+                }
+            }
+        } else {
+            ProgramChangeEvent* ev = static_cast<ProgramChangeEvent*>(ref.ev);
+            if (programs[chan] == ev->program()) {
+                redundant.insert(ev);
+            } else {
+                programs[chan] = ev->program();
+            }
+        }
+    }
+
+    static const std::type_info& sysexId = typeid(SysExEvent);
+    for(auto it = m_tracksList.cbegin(); it != m_tracksList.cend(); ++it) {
+        QList<QByteArray> tickSysex;
+        long sysexTick = -1;
+        foreach(MIDIEvent* ev, it.value()) {
+            if (typeid(*ev) == sysexId) {
+                QByteArray data = static_cast<SysExEvent*>(ev)->data();
+                if (ev->tick() != sysexTick) {
+                    tickSysex.clear();
+                    sysexTick = ev->tick();
+                }
+                if (tickSysex.contains(data)) {
+                    redundant.insert(ev);
+                } else {
+                    tickSysex.append(data);
+                }
+            }
+        }
+    }
+    return redundant;
 }
 
 void Sequence::setOutputFormat(int outputType)
@@ -209,6 +687,63 @@ void Sequence::setOutputFormat(int outputType)
     m_format = outputType;
 }
 
+/**
+ * Restarts the merged event cursor at the beginning of the song.
+ * It must be called again after the tracks are modified.
+ */
+void Sequence::rewind()
+{
+    m_cursors.clear();
+    m_pos = 0;
+    m_cursorTrack = -1;
+    for(auto it = m_tracksList.cbegin(); it != m_tracksList.cend(); ++it) {
+        if (!it.value().isEmpty()) {
+            m_cursors.append({ it.value().first()->tick(), it.key(), 0, &it.value() });
+        }
+    }
+    std::make_heap(m_cursors.begin(), m_cursors.end(), CursorAfter());
+}
+
+/**
+ * Returns the next event of the song, merging all the tracks by time,
+ * without copying or sorting them again. The track of the event is
+ * given by eventTrack().
+ * @return The next event, or nullptr at the end of the song.
+ */
+MIDIEvent *Sequence::nextEvent()
+{
+    if (m_cursors.isEmpty()) {
+        return nullptr;
+    }
+    std::pop_heap(m_cursors.begin(), m_cursors.end(), CursorAfter());
+    TrackCursor& cursor = m_cursors.last();
+    MIDIEvent* ev = cursor.list->at(cursor.index);
+    m_cursorTrack = cursor.track;
+    if (++cursor.index < cursor.list->size()) {
+        cursor.tick = cursor.list->at(cursor.index)->tick();
+        std::push_heap(m_cursors.begin(), m_cursors.end(), CursorAfter());
+    } else {
+        m_cursors.removeLast();
+    }
+    m_pos++;
+    return ev;
+}
+
+bool Sequence::hasMoreEvents()
+{
+    return !m_cursors.isEmpty();
+}
+
+/**
+ * Real time of an event, using the tempo map and the tempo factor.
+ * @param ev An event of the song.
+ * @return The time in milliseconds since the start of the song.
+ */
+int Sequence::eventTime(MIDIEvent *ev) const
+{
+    return static_cast<int>(timeOfTicks(ev->tick()).count());
+}
+
 int Sequence::returnCode()
 {
     return m_returnCode;
@@ -219,6 +754,26 @@ QString Sequence::currentFile() const
     return m_currentFile;
 }
 
+int Sequence::eventCount() const
+{
+    int count = 0;
+    for(auto it = m_tracksList.cbegin(); it != m_tracksList.cend(); ++it) {
+        count += it.value().count();
+    }
+    return count;
+}
+
+QMap<int, QByteArray> Sequence::trackNames() const
+{
+    QMap<int, QByteArray> names;
+    for(auto it = m_trackMap.cbegin(); it != m_trackMap.cend(); ++it) {
+        if (it.value().nameSet) {
+            names[it.key()] = it.value().name;
+        }
+    }
+    return names;
+}
+
 void Sequence::timeCalculations()
 {
     m_ticks2millis = m_tempo / (1000.0 * m_division * m_tempoFactor);
@@ -241,12 +796,17 @@ void Sequence::setTempoFactor(const qreal factor)
 
 std::chrono::milliseconds Sequence::deltaTimeOfEvent(MIDIEvent *ev) const
 {
-    return std::chrono::milliseconds(std::lround(ev->delta() * m_ticks2millis));
+    return timeOfTicks(ev->tick()) - timeOfTicks(ev->tick() - ev->delta());
 }
 
 std::chrono::milliseconds Sequence::timeOfTicks(const int ticks) const
 {
-    return std::chrono::milliseconds(std::lround(ticks * m_ticks2millis));
+    return std::chrono::milliseconds(std::llround(m_tempoMap.microsOfTicks(ticks) / (1000.0 * m_tempoFactor)));
+}
+
+qint64 Sequence::durationMicros() const
+{
+    return m_tempoMap.microsOfTicks(m_ticksDuration);
 }
 
 qreal Sequence::currentTempo() const
@@ -272,7 +832,7 @@ void Sequence::updateTempo(qreal newTempo)
  * SMF (Standard MIDI file) format handling
  * **************************************** */
 
-void Sequence::outputEvent(MIDIEvent* ev)
+void Sequence::outputEvent(MIDIEvent* ev, long delta)
 {
     static const std::type_info& textId = typeid(TextEvent);
     static const std::type_info& tempoId = typeid(TempoEvent);
@@ -289,7 +849,7 @@ void Sequence::outputEvent(MIDIEvent* ev)
                 int key = event->key();
                 int vel = event->velocity();
                 //qDebug() << ev->tick() << "NoteOff:" << chan << key << vel;
-                m_smf->writeMidiEvent(ev->delta(), note_off, chan, key, vel);
+                m_smf->writeMidiEvent(delta, note_off, chan, key, vel);
             }
             break;
         case MIDIEvent::MIDI_STATUS_NOTEON: {
@@ -297,7 +857,7 @@ void Sequence::outputEvent(MIDIEvent* ev)
                 int vel = event->velocity();
                 int key = event->key();
                 //qDebug() << ev->tick() << "NoteOn:" << chan << key << vel;
-                m_smf->writeMidiEvent(ev->delta(), note_on, chan, key, vel);
+                m_smf->writeMidiEvent(delta, note_on, chan, key, vel);
             }
             break;
         case MIDIEvent::MIDI_STATUS_KEYPRESURE: {
@@ -305,7 +865,7 @@ void Sequence::outputEvent(MIDIEvent* ev)
                 int vel = event->velocity();
                 int key = event->key();
                 //qDebug() << event->tick() << "KeyPress:" << chan << key << vel;
-                m_smf->writeMidiEvent(ev->delta(), poly_aftertouch, chan, key, vel);
+                m_smf->writeMidiEvent(delta, poly_aftertouch, chan, key, vel);
             }
             break;
         case MIDIEvent::MIDI_STATUS_CONTROLCHANGE: {
@@ -313,21 +873,21 @@ void Sequence::outputEvent(MIDIEvent* ev)
                 int par = event->param();
                 int val = event->value();
                 //qDebug() << event->tick() << "CtrlChg:" << chan << par << val;
-                m_smf->writeMidiEvent(ev->delta(), control_change, chan, par, val);
+                m_smf->writeMidiEvent(delta, control_change, chan, par, val);
             }
             break;
         case MIDIEvent::MIDI_STATUS_PROGRAMCHANGE: {
                 ProgramChangeEvent* event = static_cast<ProgramChangeEvent*>(ev);
                 int pgm = event->program();
                 //qDebug() << event->tick() << "PgmChg:" << chan << pgm;
-                m_smf->writeMidiEvent(ev->delta(), program_chng, chan, pgm);
+                m_smf->writeMidiEvent(delta, program_chng, chan, pgm);
             }
             break;
         case MIDIEvent::MIDI_STATUS_CHANNELPRESSURE: {
                 ChanPressEvent* event = static_cast<ChanPressEvent*>(ev);
                 int val = event->value();
                 //qDebug() << event->tick() << "ChanPress:" << chan << val;
-                m_smf->writeMidiEvent(ev->delta(), channel_aftertouch, chan, val);
+                m_smf->writeMidiEvent(delta, channel_aftertouch, chan, val);
             }
             break;
         case MIDIEvent::MIDI_STATUS_PITCHBEND: {
@@ -336,7 +896,7 @@ void Sequence::outputEvent(MIDIEvent* ev)
                 int lsb = val % 0x80;
                 int msb = val / 0x80;
                 //qDebug() << event->tick() << "Bender:" << chan << val << lsb << msb;
-                m_smf->writeMidiEvent(ev->delta(), pitch_wheel, chan, lsb, msb);
+                m_smf->writeMidiEvent(delta, pitch_wheel, chan, lsb, msb);
             }
             break;
         default:
@@ -348,18 +908,18 @@ void Sequence::outputEvent(MIDIEvent* ev)
         if (typeid(*ev) == sysexId) {
             SysExEvent* event = static_cast<SysExEvent*>(ev);
             //qDebug() << event->tick() << "SysEx:"  << event->data().toHex();
-            m_smf->writeMidiEvent(ev->delta(), system_exclusive, 0, event->data());
+            m_smf->writeMidiEvent(delta, system_exclusive, 0, event->data());
         } else
         if (typeid(*ev) == textId) {
             TextEvent* event = static_cast<TextEvent*>(ev);
             //qDebug() << event->tick() << "Text(" << event->textType() << "): " << event->data();
-            m_smf->writeMetaEvent(ev->delta(), event->textType(), event->data());
+            m_smf->writeMetaEvent(delta, event->textType(), event->data());
         } else
         if (typeid(*ev) == tempoId) {
             TempoEvent* event = static_cast<TempoEvent*>(ev);
             auto tempo = event->tempo();
             //qDebug() << ev->tick() << "Tempo:" << tempo << "bpm:" << event->bpm();
-            m_smf->writeTempo(ev->delta(), tempo);
+            m_smf->writeTempo(delta, tempo);
         } else
         if (typeid(*ev) == timeSigId) {
             TimeSignatureEvent* event = static_cast<TimeSignatureEvent*>(ev);
@@ -368,12 +928,12 @@ void Sequence::outputEvent(MIDIEvent* ev)
                 ++dd;
             }
             //qDebug() << ev->tick() << "TimeSignature:" << event->numerator() << "/" << event->denominator() << dd;
-            m_smf->writeTimeSignature(ev->delta(), event->numerator(), dd, 24, 8);
+            m_smf->writeTimeSignature(delta, event->numerator(), dd, 24, 8);
         } else
         if (typeid(*ev) == keySigId) {
             KeySignatureEvent* event = static_cast<KeySignatureEvent*>(ev);
             //qDebug() << ev->tick() << "KeySignature:" << event->alterations() << event->minorMode();
-            m_smf->writeKeySignature(ev->delta(), event->alterations(), event->minorMode());
+            m_smf->writeKeySignature(delta, event->alterations(), event->minorMode());
         } /*else {
             qDebug() << ev->tick() << "unknown meta event:" << typeid(*ev).name();
         }*/
@@ -395,23 +955,41 @@ void Sequence::smfTrackHandler(int track)
         }
     }
     if (m_tracksList[track].count() > 0) {
+        TraceSpan span("encode", track);
+        WRK2MID_PROBE2(encode__start, track, m_tracksList[track].count());
         if (m_trackMap[track].port > -1) {
             m_smf->writeMetaEvent(0, forced_port, m_trackMap[track].port);
         }
         //Debug() << Q_FUNC_INFO << "track:" << track << "events:" << m_tracksList[track].count() << "channel:" << m_trkChannel[track];
+        long lastEventTicks = 0;
         for(auto it = m_tracksList[track].cbegin(); it != m_tracksList[track].cend(); ++it) {
             MIDIEvent* ev = *it;
-            outputEvent(ev);
+            if (m_redundant.contains(ev)) {
+                continue;
+            }
+            outputEvent(ev, ev->tick() - lastEventTicks);
+            lastEventTicks = ev->tick();
         }
         // final event
         m_smf->writeMetaEvent(0, end_of_track);
+        WRK2MID_PROBE1(encode__end, track);
     }
 }
 
+/*
+ * Diagnostics are not printed by the library: they are kept until the
+ * next load, and emitted for the program to print them.
+ */
+void Sequence::report(const QString& text)
+{
+    m_messages.append(text);
+    emit message(text);
+}
+
 void Sequence::smfErrorHandler(const QString& errorStr)
 {
-    std::cerr << errorStr.toStdString() << " at file offset " << m_smf->getFilePos() << std::endl;
-    m_returnCode = EXIT_FAILURE;
+    report(QString("%1 at file offset %2").arg(errorStr).arg(m_smf->getFilePos()));
+    m_saveError = true;
 }
 
 /* ********************************* *
@@ -420,17 +998,76 @@ void Sequence::smfErrorHandler(const QString& errorStr)
 
 void Sequence::wrkUpdateLoadProgress()
 {
+    checkTimeout();
     emit loadingProgress(m_wrk->getFilePos());
 }
 
+void Sequence::checkTimeout()
+{
+    if (m_limits.timeout > 0 && m_loadTimer.hasExpired(m_limits.timeout)) {
+        throw LimitExceededError("loading timeout");
+    }
+}
+
+/*
+ * The memory usage is an estimation: the size of the event objects,
+ * the pointers in the track lists, and the variable length data.
+ * The event is released when a limit is exceeded.
+ */
+void Sequence::checkLimits(long ticks, MIDIEvent* ev)
+{
+    qint64 size = sizeof(KeyEvent) + sizeof(MIDIEvent*);
+    if (ev->isMetaEvent()) {
+        VariableEvent* vev = dynamic_cast<VariableEvent*>(ev);
+        if (vev != nullptr) {
+            size += sizeof(VariableEvent) + vev->length();
+        }
+    }
+    const char* error = nullptr;
+    if (m_limits.maxEvents > 0 && m_eventCount >= m_limits.maxEvents) {
+        error = "too many events";
+    } else if (m_limits.maxTicks > 0 && ticks > m_limits.maxTicks) {
+        error = "event time too large";
+    } else if (m_limits.maxMemory > 0 && m_memoryUsage + size > m_limits.maxMemory) {
+        error = "memory limit";
+    }
+    if (error != nullptr) {
+        delete ev;
+        throw LimitExceededError(error);
+    }
+    m_eventCount++;
+    m_memoryUsage += size;
+}
+
+/*
+ * The meter records are counted as events while they are collected, and
+ * replaced by the events created from them in appendMeterEvents().
+ */
+void Sequence::countMeterRecord()
+{
+    const qint64 size = sizeof(MeterMap::TimeSigRec);
+    if (m_limits.maxEvents > 0 && m_eventCount >= m_limits.maxEvents) {
+        throw LimitExceededError("too many events");
+    }
+    if (m_limits.maxMemory > 0 && m_memoryUsage + size > m_limits.maxMemory) {
+        throw LimitExceededError("memory limit");
+    }
+    m_eventCount++;
+    m_memoryUsage += size;
+}
+
 void Sequence::appendWRKEvent(long ticks, MIDIEvent* ev)
 {
+    checkLimits(ticks, ev);
     int t = m_format == 0 ? 0 : m_curTrack;
     ev->setTick(ticks);
     if (ev->tag() <= 0) {
         ev->setTag(t);
     }
-    m_tracksList[t].append(ev);
+    trackEvents(t).append(ev);
+    if (WRK2MID_PROBE_ENABLED(event)) {
+        WRK2MID_PROBE3(event, t, ticks, ev->status());
+    }
     if (ticks > m_ticksDuration) {
         m_ticksDuration = ticks;
     }
@@ -439,12 +1076,19 @@ void Sequence::appendWRKEvent(long ticks, MIDIEvent* ev)
 
 void Sequence::wrkErrorHandler(const QString& errorStr)
 {
-    std::cerr << errorStr.toStdString() << " at file offset " << m_wrk->getFilePos() << std::endl;
-    m_returnCode = EXIT_FAILURE;
+    report(QString("%1 at file offset %2").arg(errorStr).arg(m_wrk->getFilePos()));
+    if (m_salvage) {
+        if (m_salvageErrorPos < 0) {
+            m_salvageErrorPos = m_wrk->getFilePos();
+        }
+    } else {
+        m_returnCode = EXIT_FAILURE;
+    }
 }
 
 void Sequence::wrkFileHeader(int verh, int verl)
 {
+    traceChunk(TRACE_HEADER);
     //qDebug() << Q_FUNC_INFO << verh << verl;
     m_curTrack = 0;
     m_division = 120;
@@ -459,6 +1103,7 @@ void Sequence::wrkFileHeader(int verh, int verl)
 
 void Sequence::wrkTimeBase(int timebase)
 {
+    traceChunk(TRACE_TIMEBASE);
     //qDebug() << Q_FUNC_INFO << timebase;
     m_division = timebase;
     wrkUpdateLoadProgress();
@@ -466,13 +1111,16 @@ void Sequence::wrkTimeBase(int timebase)
 
 void Sequence::wrkGlobalVars()
 {
+    traceChunk(TRACE_VARS);
     //qDebug() << Q_FUNC_INFO;
-    wrkKeySig(0, m_wrk->getKeySig());
+    m_meterMap.addKeySignature(0, m_wrk->getKeySig());
+    countMeterRecord();
     wrkUpdateLoadProgress();
 }
 
 void Sequence::wrkStreamEndEvent(long time)
 {
+    traceChunk(TRACE_STREAM);
     if (time > m_ticksDuration) {
         m_ticksDuration = time;
     }
@@ -485,6 +1133,7 @@ void Sequence::wrkTrackHeader( const QByteArray& name1,
                            int pitch, int velocity, int port,
                            bool /*selected*/, bool /*muted*/, bool /*loop*/ )
 {
+    traceChunk(TRACE_TRACK);
     TrackMapRec rec;
     rec.channel = channel;
     rec.pitch = pitch;
@@ -498,6 +1147,7 @@ void Sequence::wrkTrackHeader( const QByteArray& name1,
     trkName = trkName.trimmed();
     if (!trkName.isEmpty()) {
         m_trackMap[m_curTrack].nameSet = true;
+        m_trackMap[m_curTrack].name = trkName;
         appendWRKmetadata(m_curTrack, 0, TextType::TrackName, trkName);
     }
     wrkUpdateLoadProgress();
@@ -505,6 +1155,7 @@ void Sequence::wrkTrackHeader( const QByteArray& name1,
 
 void Sequence::wrkNoteEvent(int track, long time, int chan, int pitch, int vol, int dur)
 {
+    traceChunk(TRACE_STREAM);
     TrackMapRec rec = m_trackMap[track+1];
     int channel = rec.channel > -1 ? rec.channel : chan;
     int key = qBound(0, pitch + rec.pitch, 127);
@@ -522,6 +1173,7 @@ void Sequence::wrkNoteEvent(int track, long time, int chan, int pitch, int vol,
 
 void Sequence::wrkKeyPressEvent(int track, long time, int chan, int pitch, int press)
 {
+    traceChunk(TRACE_STREAM);
     TrackMapRec rec = m_trackMap[track+1];
     int channel = rec.channel > -1 ? rec.channel : chan;
     int key = pitch + rec.pitch;
@@ -532,6 +1184,16 @@ void Sequence::wrkKeyPressEvent(int track, long time, int chan, int pitch, int p
 }
 
 void Sequence::wrkCtlChangeEvent(int track, long time, int chan, int ctl, int value)
+{
+    traceChunk(TRACE_STREAM);
+    appendController(track, time, chan, ctl, value);
+}
+
+/*
+ * The controller and program change handlers are also used by the track
+ * chunk handlers, without tracing, so the spans keep the chunk type.
+ */
+void Sequence::appendController(int track, long time, int chan, int ctl, int value)
 {
     TrackMapRec rec = m_trackMap[track+1];
     int channel = rec.channel > -1 ? rec.channel : chan;
@@ -543,6 +1205,7 @@ void Sequence::wrkCtlChangeEvent(int track, long time, int chan, int ctl, int va
 
 void Sequence::wrkPitchBendEvent(int track, long time, int chan, int value)
 {
+    traceChunk(TRACE_STREAM);
     TrackMapRec rec = m_trackMap[track+1];
     int channel = rec.channel > -1 ? rec.channel : chan;
     MIDIEvent* ev = new PitchBendEvent(channel, value);
@@ -551,6 +1214,12 @@ void Sequence::wrkPitchBendEvent(int track, long time, int chan, int value)
 }
 
 void Sequence::wrkProgramEvent(int track, long time, int chan, int patch)
+{
+    traceChunk(TRACE_STREAM);
+    appendProgram(track, time, chan, patch);
+}
+
+void Sequence::appendProgram(int track, long time, int chan, int patch)
 {
     if (patch >= 0 && patch < 128) {
         TrackMapRec rec = m_trackMap[track+1];
@@ -564,6 +1233,7 @@ void Sequence::wrkProgramEvent(int track, long time, int chan, int patch)
 
 void Sequence::wrkChanPressEvent(int track, long time, int chan, int press)
 {
+    traceChunk(TRACE_STREAM);
     TrackMapRec rec = m_trackMap[track+1];
     int channel = rec.channel > -1 ? rec.channel : chan;
     MIDIEvent* ev = new ChanPressEvent(channel, press);
@@ -573,6 +1243,7 @@ void Sequence::wrkChanPressEvent(int track, long time, int chan, int press)
 
 void Sequence::wrkSysexEvent(int track, long time, int bank)
 {
+    traceChunk(TRACE_STREAM);
     Q_UNUSED(track)
     //qDebug() << Q_FUNC_INFO;
     if (m_savedSysexEvents.contains(bank)) {
@@ -585,18 +1256,23 @@ void Sequence::wrkSysexEvent(int track, long time, int bank)
 void Sequence::wrkSysexEventBank(int bank, const QString& name,
         bool autosend, int port, const QByteArray& data)
 {
-    Q_UNUSED(name)
+    traceChunk(TRACE_SYSEX);
     Q_UNUSED(port)
     //qDebug() << Q_FUNC_INFO << bank << name << autosend << data;
+    m_sysexBanks[bank] = name;
+    if (m_limits.maxSysexBytes > 0 && data.size() > m_limits.maxSysexBytes) {
+        throw LimitExceededError("sysex message too long");
+    }
     SysExEvent* ev = new SysExEvent(data);
     if (autosend) {
         auto savedTrack = m_curTrack;
         m_curTrack = 0;
-        appendWRKEvent(0, ev->clone());
+        appendWRKEvent(0, ev);
         m_curTrack = savedTrack;
-        delete ev;
     } else {
+        delete m_savedSysexEvents.value(bank, nullptr);
         m_savedSysexEvents[bank] = ev;
+        m_memoryUsage += data.size();
     }
     wrkUpdateLoadProgress();
 }
@@ -611,17 +1287,21 @@ void Sequence::appendWRKmetadata(int track, long time, Sequence::TextType type,
 
 void Sequence::wrkTextEvent(int track, long time, int /*type*/, const QByteArray &data)
 {
+    traceChunk(TRACE_STREAM);
     //qDebug() << "track:" << track+1 << "time:" << time << "type:" << type << "data:" << data;
     appendWRKmetadata(track+1, time, TextType::Lyric, data);
 }
 
 void Sequence::wrkComments(const QByteArray &cmt)
 {
+    traceChunk(TRACE_COMMENTS);
     appendWRKmetadata(1, 0, TextType::Text, cmt);
 }
 
 void Sequence::wrkVariableRecord(const QString &name, const QByteArray &data)
 {
+    traceChunk(TRACE_COMMENTS);
+    m_variables[name] = data;
     bool isReadable = (name == "Title" || name == "Author" ||
                        name == "Copyright" || name == "Subtitle" ||
                        name == "Instructions" || name == "Keywords");
@@ -647,20 +1327,20 @@ void Sequence::wrkVariableRecord(const QString &name, const QByteArray &data)
 
 void Sequence::wrkTempoEvent(long time, int tempo)
 {
+    traceChunk(TRACE_TEMPO);
     double bpm = tempo / 100.0;
     TempoEvent* ev = new TempoEvent(qRound ( 6e7 / bpm ) );
     //qDebug() << Q_FUNC_INFO << "Tempo:" << ev->tempo() << "bpm:" << bpm;
     appendWRKEvent(time, ev);
-    if (time == 0) {
-        updateTempo(bpm);
-    }
+    m_tempoMap.addTempo(time, qRound64(ev->tempo()));
 }
 
 void Sequence::wrkTrackPatch(int track, int patch)
 {
+    traceChunk(TRACE_TRACK);
     TrackMapRec rec = m_trackMap[track+1];
     int channel = rec.channel > -1 ? rec.channel : 0;
-    wrkProgramEvent(track+1, 0, channel, patch);
+    appendProgram(track+1, 0, channel, patch);
     //qDebug() << Q_FUNC_INFO << track << patch;
 }
 
@@ -669,6 +1349,7 @@ void Sequence::wrkNewTrackHeader( const QByteArray& data,
                               int pitch, int velocity, int port,
                               bool /*selected*/, bool /*muted*/, bool /*loop*/ )
 {
+    traceChunk(TRACE_TRACK);
     TrackMapRec rec;
     rec.channel = channel;
     rec.pitch = pitch;
@@ -680,6 +1361,7 @@ void Sequence::wrkNewTrackHeader( const QByteArray& data,
     m_trackMap[m_curTrack] = rec;
     if (!data.isEmpty()) {
         m_trackMap[m_curTrack].nameSet = true;
+        m_trackMap[m_curTrack].name = data;
         appendWRKmetadata(m_curTrack, 0, TextType::TrackName, data);
     }
     wrkUpdateLoadProgress();
@@ -687,42 +1369,47 @@ void Sequence::wrkNewTrackHeader( const QByteArray& data,
 
 void Sequence::wrkTrackName(int trackno, const QByteArray &data)
 {
+    traceChunk(TRACE_TRACK);
     if (!m_trackMap[m_curTrack].nameSet) {
         m_trackMap[m_curTrack].nameSet = true;
+        m_trackMap[m_curTrack].name = data;
         appendWRKmetadata(trackno+1, 0, TextType::TrackName, data);
     }
 }
 
 void Sequence::wrkTrackVol(int track, int vol)
 {
+    traceChunk(TRACE_TRACK);
     int lsb, msb;
     TrackMapRec rec = m_trackMap[track+1];
     int channel = (rec.channel > -1) ? rec.channel : 0;
     //qDebug() << Q_FUNC_INFO << track << channel << vol;
     if (vol < 128) {
-        wrkCtlChangeEvent(track, 0, channel, ControllerEvent::MIDI_CTL_MSB_MAIN_VOLUME, vol);
+        appendController(track, 0, channel, ControllerEvent::MIDI_CTL_MSB_MAIN_VOLUME, vol);
     } else {
         lsb = vol % 0x80;
         msb = vol / 0x80;
-        wrkCtlChangeEvent(track, 0, channel, ControllerEvent::MIDI_CTL_LSB_MAIN_VOLUME, lsb);
-        wrkCtlChangeEvent(track, 0, channel, ControllerEvent::MIDI_CTL_MSB_MAIN_VOLUME, msb);
+        appendController(track, 0, channel, ControllerEvent::MIDI_CTL_LSB_MAIN_VOLUME, lsb);
+        appendController(track, 0, channel, ControllerEvent::MIDI_CTL_MSB_MAIN_VOLUME, msb);
     }
 }
 
 void Sequence::wrkTrackBank(int track, int bank)
 {
+    traceChunk(TRACE_TRACK);
     // assume GM/GS bank method
     int lsb, msb;
     TrackMapRec rec = m_trackMap[track+1];
     int channel = rec.channel > -1 ? rec.channel : 0;
     lsb = bank % 0x80;
     msb = bank / 0x80;
-    wrkCtlChangeEvent(track+1, 0, channel, ControllerEvent::MIDI_CTL_MSB_BANK, msb);
-    wrkCtlChangeEvent(track+1, 0, channel, ControllerEvent::MIDI_CTL_LSB_BANK, lsb);
+    appendController(track+1, 0, channel, ControllerEvent::MIDI_CTL_MSB_BANK, msb);
+    appendController(track+1, 0, channel, ControllerEvent::MIDI_CTL_LSB_BANK, lsb);
 }
 
 void Sequence::wrkSegment(int track, long time, const QByteArray &name)
 {
+    traceChunk(TRACE_STREAM);
     if (!name.isEmpty()) {
         appendWRKmetadata(track+1, time, TextType::Marker, name);
     }
@@ -730,71 +1417,82 @@ void Sequence::wrkSegment(int track, long time, const QByteArray &name)
 
 void Sequence::wrkChord(int track, long time, const QString &name, const QByteArray& /*data*/)
 {
+    traceChunk(TRACE_STREAM);
     QByteArray data = name.toUtf8();
     appendWRKmetadata(track+1, time, TextType::Cue, data);
 }
 
 void Sequence::wrkExpression(int track, long time, int /*code*/, const QByteArray &text)
 {
+    traceChunk(TRACE_STREAM);
     appendWRKmetadata(track+1, time, TextType::Cue, text);
 }
 
 void Sequence::wrkTimeSignatureEvent(int bar, int num, int den)
 {
-    if (!m_timeSignatureSet) {
-        MIDIEvent* ev = new TimeSignatureEvent(num, den);
-        m_beatMax = num;
-        m_beatLength = m_division * 4 / den;
-
-        TimeSigRec newts;
-        newts.bar = bar;
-        newts.num = num;
-        newts.den = den;
-        newts.time = 0;
-        if (m_bars.isEmpty()) {
-            m_bars.append(newts);
-        } else {
-            bool found = false;
-            foreach(const TimeSigRec& ts, m_bars) {
-                if (ts.bar == bar) {
-                    newts.time = ts.time;
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                TimeSigRec& lasts = m_bars.last();
-                newts.time = lasts.time +
-                        (lasts.num * 4 * m_division / lasts.den * (bar - lasts.bar));
-                m_bars.append(newts);
-            }
-        }
-        ev->setTag( bar );
-        appendWRKEvent(newts.time, ev);
-        //qDebug() << Q_FUNC_INFO << newts.time << bar << num << den;
-        m_timeSignatureSet = true;
+    traceChunk(TRACE_METER);
+    //qDebug() << Q_FUNC_INFO << bar << num << den;
+    if (m_meterMap.addTimeSignature(bar, num, den)) {
+        countMeterRecord();
     }
+    wrkUpdateLoadProgress();
 }
 
 void Sequence::wrkKeySig(int bar, int alt)
 {
-    if (!m_keySignatureSet) {
-        MIDIEvent *ev = new KeySignatureEvent(alt, false);
-        long time = 0;
-        foreach(const TimeSigRec& ts, m_bars) {
-            if (ts.bar == bar) {
-                time = ts.time;
-                break;
+    traceChunk(TRACE_METER);
+    //qDebug() << Q_FUNC_INFO << bar << alt;
+    m_meterMap.addKeySignature(bar, alt);
+    countMeterRecord();
+    wrkUpdateLoadProgress();
+}
+
+/*
+ * The time and key signatures are collected while loading, because
+ * the bars may only be translated into ticks when the whole meter map
+ * is known. They are prepended to the first track, in bar order.
+ * The records counted while loading are released, and the events are
+ * checked against the limits like the other ones.
+ */
+void Sequence::appendMeterEvents()
+{
+    const qint64 records = m_meterMap.timeSignatures() + m_meterMap.keySignatures();
+    m_eventCount -= records;
+    m_memoryUsage -= records * qint64(sizeof(MeterMap::TimeSigRec));
+    m_meterMap.build(m_division);
+    EventsList events;
+    try {
+        for (int i = 0; i < m_meterMap.timeSignatures(); ++i) {
+            const MeterMap::TimeSigRec& rec = m_meterMap.timeSignature(i);
+            MIDIEvent* ev = new TimeSignatureEvent(rec.num, rec.den);
+            checkLimits(rec.tick, ev);
+            ev->setTick(rec.tick);
+            ev->setTag(rec.bar);
+            events.append(ev);
+            if (i == 0) {
+                m_beatMax = rec.num;
+                m_beatLength = m_division * 4 / rec.den;
             }
         }
-        appendWRKEvent(time, ev);
-        //qDebug() << Q_FUNC_INFO << time << alt;
-        m_keySignatureSet = true;
+        for (int i = 0; i < m_meterMap.keySignatures(); ++i) {
+            const MeterMap::KeySigRec& rec = m_meterMap.keySignature(i);
+            MIDIEvent* ev = new KeySignatureEvent(rec.alterations, false);
+            checkLimits(rec.tick, ev);
+            ev->setTick(rec.tick);
+            events.append(ev);
+        }
+    } catch (...) {
+        qDeleteAll(events);
+        throw;
+    }
+    if (!events.isEmpty()) {
+        m_tracksList[0] = events + m_tracksList[0];
     }
 }
 
 void Sequence::wrkMarker(long time, int smpte, const QByteArray &data)
 {
+    traceChunk(TRACE_MARKERS);
     Q_UNUSED(smpte)
     //qDebug() << Q_FUNC_INFO << time << smpte << data;
     if (!data.isEmpty()) {
@@ -19,15 +19,42 @@
 #ifndef SEQUENCE_H
 #define SEQUENCE_H
 
+#include <stdexcept>
 #include <QObject>
+#include <QElapsedTimer>
+#include <QIODevice>
 #include <QList>
 #include <QMap>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
 #include <drumstick/qsmf.h>
 #include <drumstick/qwrk.h>
 #include "events.h"
+#include "tempomap.h"
+#include "metermap.h"
+#include "outputcommitter.h"
+#include "wrkchunks.h"
 
 typedef QList<MIDIEvent*> EventsList;
 
+/**
+ * Exception thrown while loading a file when a resource limit is exceeded
+ */
+class LimitExceededError : public std::runtime_error
+{
+public:
+    explicit LimitExceededError(const std::string& what) : std::runtime_error(what) { }
+};
+
+/**
+ * A song loaded from a WRK file, and its conversion to SMF.
+ *
+ * Songs can be loaded and saved using files, memory buffers or any
+ * QIODevice. Each instance owns its own parser and writer, and the
+ * class is reentrant: distinct instances may be used concurrently from
+ * different threads.
+ */
 class Sequence : public QObject
 {
     Q_OBJECT
@@ -40,26 +67,64 @@ public:
     };
     Q_ENUM(TextType)
 
+    enum ReturnCode {
+        ReturnSuccess = EXIT_SUCCESS,
+        ReturnFailure = EXIT_FAILURE,
+        ReturnLimitExceeded = 3,
+        ReturnSalvaged = 4
+    };
+
+    /**
+     * Resource limits enforced while loading a file. Zero means unlimited.
+     */
+    struct Limits {
+        Limits(): maxEvents(0), maxMemory(0), maxSysexBytes(0), maxTicks(0), timeout(0) { };
+        qint64 maxEvents;       ///< number of events
+        qint64 maxMemory;       ///< estimated bytes used by events
+        qint64 maxSysexBytes;   ///< length of a single sysex message
+        qint64 maxTicks;        ///< musical time of any event
+        qint64 timeout;         ///< loading time in milliseconds
+    };
+
     explicit Sequence(QObject* parent = 0);
     virtual ~Sequence();
 
     void clear();
+    void reset();
     void appendEvent(MIDIEvent* ev);
     void loadPattern(QList<MIDIEvent*> pattern);
     void loadFile(const QString& fileName);
     void saveFile(const QString& fileName);
+    void loadData(const QByteArray& data);
+    void loadStream(QIODevice* device);
+    QByteArray saveData();
+    bool saveStream(QIODevice* device);
     void setOutputFormat(int outputType);
+    void setLimits(const Limits& limits) { m_limits = limits; }
+    Limits limits() const { return m_limits; }
     int returnCode();
+    bool hasSong() const { return m_returnCode == ReturnSuccess || m_returnCode == ReturnSalvaged; }
+    void setSalvage(bool enable) { m_salvage = enable; }
+    void setOptimizeSize(bool enable) { m_optimizeSize = enable; }
+    void setThinning(int maxError, int minSpacing) { m_thinError = maxError; m_thinSpacing = minSpacing; }
+    void setDurability(OutputCommitter::Durability durability) { m_durability = durability; }
+    QList<ByteRange> skippedRanges() const { return m_skipped; }
 
     qreal tempoFactor() const;
     void setTempoFactor(const qreal factor);
+    void rewind();
     MIDIEvent *nextEvent();
     int eventTime(MIDIEvent* ev) const;
+    int eventTrack() const { return m_cursorTrack; }
     std::chrono::milliseconds deltaTimeOfEvent(MIDIEvent* ev) const;
     std::chrono::milliseconds timeOfTicks(const int ticks) const;
+    qint64 durationMicros() const;
+    const TempoMap& tempoMap() const { return m_tempoMap; }
+    const MeterMap& meterMap() const { return m_meterMap; }
     bool hasMoreEvents();
     int getFormat() const { return m_format; }
     int getDivision() const { return m_division; }
+    const QMap<int, EventsList>& tracks() const { return m_tracksList; }
     bool isEmpty();
 
     qreal currentTempo() const;
@@ -68,11 +133,17 @@ public:
     void updateTempo(qreal newTempo);
     qreal ticks2millis() const { return m_ticks2millis; }
     QString currentFile() const;
+    int eventCount() const;
+    QMap<int, QByteArray> trackNames() const;
+    QMap<QString, QByteArray> variables() const { return m_variables; }
+    QMap<int, QString> sysexBanks() const { return m_sysexBanks; }
+    QStringList messages() const { return m_messages; }
 
 signals:
     void loadingStart(int size);
     void loadingProgress(int pos);
     void loadingFinished();
+    void message(const QString& text);
 
 public slots:
     /* SMF slots */
@@ -125,19 +196,58 @@ private: // methods
     void timeCalculations();
     void addMetaData(int time, int type, const QByteArray &data);
     void appendStringToList(QStringList &list, QString &s, TextType type);
-    void outputEvent(MIDIEvent* ev);
+    void outputEvent(MIDIEvent* ev, long delta);
+    void appendMeterEvents();
+    void checkLimits(long ticks, MIDIEvent* ev);
+    void countMeterRecord();
+    void checkTimeout();
+    void salvageData(const QByteArray& data);
+    QSet<MIDIEvent*> redundantEvents() const;
+    void thinControllers();
+    void traceChunk(const char* chunk);
+    void probeChunk(const char* chunk);
+    void appendController(int track, long time, int chan, int ctl, int value);
+    void appendProgram(int track, long time, int chan, int patch);
+    void report(const QString& text);
+    EventsList& trackEvents(int track);
 
 private: // members
+    /**
+     * Position of the merged event cursor within a track
+     */
+    struct TrackCursor {
+        long tick;
+        int track;
+        int index;
+        const EventsList* list;
+    };
+    /**
+     * Heap order of the cursor: earliest tick first, and events at the
+     * same tick in track order, so the merge is stable.
+     */
+    struct CursorAfter {
+        bool operator()(const TrackCursor& a, const TrackCursor& b) const {
+            return a.tick > b.tick || (a.tick == b.tick && a.track > b.track);
+        }
+    };
+    QVector<TrackCursor> m_cursors;
     QMap<int, EventsList> m_tracksList;
+    static const int MAX_SPARE_LISTS = 256;
+    QList<EventsList> m_spareLists;
+    TempoMap m_tempoMap;
+    MeterMap m_meterMap;
     drumstick::File::QSmf* m_smf;
     drumstick::File::QWrk* m_wrk;
 
     int m_returnCode;
+    bool m_saveError;
+    QStringList m_messages;
     int m_format;
     int m_ticksDuration;
     int m_division;
     int m_pos;
     int m_curTrack;
+    int m_cursorTrack;
     int m_beatMax;
     int m_barCount;
     int m_beatCount;
@@ -152,6 +262,8 @@ private: // members
     qint64 m_tick;
     QString m_lblName;
     QMap<int, SysExEvent*> m_savedSysexEvents;
+    QMap<int, QString> m_sysexBanks;
+    QMap<QString, QByteArray> m_variables;
 
     struct TrackMapRec {
         TrackMapRec(): channel(-1), pitch(-1), velocity(-1), port(-1), nameSet(false) { };
@@ -160,17 +272,10 @@ private: // members
         int velocity;
         int port;
         bool nameSet;
+        QByteArray name;
     };
     QMap<int,TrackMapRec> m_trackMap;
 
-    struct TimeSigRec {
-        int bar;
-        int num;
-        int den;
-        long time;
-    };
-    QList<TimeSigRec> m_bars;
-
     struct TextRec {
         TextRec(QByteArray data): m_tick(0), m_track(0), m_type(TextType::None), m_text(data) { };
         TextRec(int tick, int track, TextType e, QByteArray data): m_tick(tick), m_track(track), m_type(e), m_text(data) { };
@@ -181,10 +286,27 @@ private: // members
     };
     QList<TextRec> m_textEvents;
 
+    Limits m_limits;
+    qint64 m_eventCount;
+    qint64 m_memoryUsage;
+    QElapsedTimer m_loadTimer;
+    bool m_salvage;
+    bool m_optimizeSize;
+    QSet<MIDIEvent*> m_redundant;  ///< events skipped while saving
+    int m_thinError;
+    int m_thinSpacing;
+    OutputCommitter::Durability m_durability;
+    qint64 m_highWater;     ///< event memory retained by reset()
+    int m_listHighWater;    ///< longest track list retained by reset()
+    const char* m_traceChunk;   ///< the WRK chunk type being traced
+    qint64 m_traceStart;
+    const char* m_probeChunk;   ///< the WRK chunk type of the last chunk probe
+    qint64 m_recordEnd;         ///< parser position after the last record
+    qint64 m_salvageErrorPos;
+    QList<ByteRange> m_skipped;
+
     QString m_currentFile;
     QString m_fileFormat;
-    bool m_timeSignatureSet;
-    bool m_keySignatureSet;
     bool m_copyrightSet;
 };
 
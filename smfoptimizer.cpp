@@ -0,0 +1,180 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtEndian>
+#include "smfoptimizer.h"
+
+namespace {
+
+class TrackReader
+{
+public:
+    TrackReader(const char* data, qint64 length) :
+        m_data(reinterpret_cast<const quint8*>(data)), m_length(length), m_pos(0), m_error(false)
+    { }
+
+    bool atEnd() const { return m_pos >= m_length || m_error; }
+    bool error() const { return m_error; }
+
+    quint8 byte()
+    {
+        if (m_pos >= m_length) {
+            m_error = true;
+            return 0;
+        }
+        return m_data[m_pos++];
+    }
+
+    quint32 varLen()
+    {
+        quint32 value = 0;
+        for (int i = 0; i < 4; ++i) {
+            quint8 c = byte();
+            value = (value << 7) | (c & 0x7f);
+            if ((c & 0x80) == 0) {
+                return value;
+            }
+        }
+        m_error = true;
+        return value;
+    }
+
+    const char* bytes(quint32 len)
+    {
+        if (m_pos + len > m_length) {
+            m_error = true;
+            return nullptr;
+        }
+        const char* p = reinterpret_cast<const char*>(m_data + m_pos);
+        m_pos += len;
+        return p;
+    }
+
+private:
+    const quint8* m_data;
+    qint64 m_length;
+    qint64 m_pos;
+    bool m_error;
+};
+
+void writeVarLen(QByteArray& out, quint32 value)
+{
+    char buffer[4];
+    int n = 0;
+    buffer[n++] = char(value & 0x7f);
+    while ((value >>= 7) > 0) {
+        buffer[n++] = char((value & 0x7f) | 0x80);
+    }
+    while (n > 0) {
+        out.append(buffer[--n]);
+    }
+}
+
+bool optimizeTrack(const char* data, qint64 length, QByteArray& out)
+{
+    TrackReader reader(data, length);
+    quint8 running = 0, lastWritten = 0;
+    while (!reader.atEnd()) {
+        quint32 delta = reader.varLen();
+        quint8 status = reader.byte();
+        quint8 data1 = 0;
+        if (status < 0x80) {
+            if (running == 0) {
+                return false;
+            }
+            data1 = status;
+            status = running;
+        } else if (status < 0xf0) {
+            data1 = reader.byte();
+        }
+        writeVarLen(out, delta);
+        if (status < 0xf0) {
+            running = status;
+            quint8 type = status & 0xf0;
+            bool twoBytes = (type != 0xc0 && type != 0xd0);
+            quint8 data2 = twoBytes ? reader.byte() : 0;
+            if (type == 0x80) {
+                status = 0x90 | (status & 0x0f);
+                data2 = 0;
+            }
+            if (status != lastWritten) {
+                out.append(char(status));
+                lastWritten = status;
+            }
+            out.append(char(data1));
+            if (twoBytes) {
+                out.append(char(data2));
+            }
+        } else {
+            out.append(char(status));
+            if (status == 0xff) {
+                out.append(char(reader.byte()));
+            } else if (status != 0xf0 && status != 0xf7) {
+                return false;
+            }
+            quint32 len = reader.varLen();
+            const char* bytes = reader.bytes(len);
+            if (reader.error()) {
+                return false;
+            }
+            writeVarLen(out, len);
+            out.append(bytes, int(len));
+            running = 0;
+            lastWritten = 0;
+        }
+    }
+    return !reader.error();
+}
+
+} // namespace
+
+QByteArray optimizeSmfEncoding(const QByteArray& smf, bool* ok)
+{
+    QByteArray result;
+    const qint64 size = smf.size();
+    qint64 pos = 0;
+    bool valid = smf.startsWith("MThd");
+    result.reserve(smf.size());
+    while (valid && pos + 8 <= size) {
+        const char* chunk = smf.constData() + pos;
+        qint64 length = qFromBigEndian<quint32>(chunk + 4);
+        if (pos + 8 + length > size) {
+            valid = false;
+            break;
+        }
+        if (qstrncmp(chunk, "MTrk", 4) == 0) {
+            QByteArray track;
+            track.reserve(int(length));
+            if (!optimizeTrack(chunk + 8, length, track)) {
+                valid = false;
+                break;
+            }
+            char prefix[8] = { 'M', 'T', 'r', 'k' };
+            qToBigEndian<quint32>(quint32(track.size()), prefix + 4);
+            result.append(prefix, 8);
+            result.append(track);
+        } else {
+            result.append(chunk, int(8 + length));
+        }
+        pos += 8 + length;
+    }
+    if (ok != nullptr) {
+        *ok = valid;
+    }
+    return valid ? result : smf;
+}
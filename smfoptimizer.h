@@ -0,0 +1,37 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SMFOPTIMIZER_H
+#define SMFOPTIMIZER_H
+
+#include <QByteArray>
+
+/**
+ * Re-encodes the tracks of a standard MIDI file to reduce its size:
+ * channel messages are written using running status, and note-off
+ * messages are written as note-on messages with velocity zero, so the
+ * running status is not interrupted by them. Meta events and system
+ * exclusive messages cancel the running status, as required by the SMF
+ * specification.
+ * @param smf The file contents.
+ * @param ok Optional, receives false if the data was not a valid SMF.
+ * @return The optimized file, or the original data if it was not valid.
+ */
+QByteArray optimizeSmfEncoding(const QByteArray& smf, bool* ok = nullptr);
+
+#endif // SMFOPTIMIZER_H
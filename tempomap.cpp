@@ -0,0 +1,126 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include "tempomap.h"
+
+TempoMap::TempoMap() : m_division(120)
+{ }
+
+void TempoMap::clear()
+{
+    m_tempos.clear();
+    m_division = 120;
+}
+
+/**
+ * Adds a tempo change. The map is not usable until build() is called.
+ * @param tick The musical time of the change.
+ * @param tempo The new tempo, in microseconds per quarter note.
+ */
+void TempoMap::addTempo(qint64 tick, qint64 tempo)
+{
+    if (tempo > 0) {
+        m_tempos.append({ tick, tempo, 0 });
+    }
+}
+
+/**
+ * Sorts the tempo changes and calculates the accumulated times.
+ * When several changes share the same tick, the last one wins.
+ * @param division Ticks per quarter note.
+ */
+void TempoMap::build(int division)
+{
+    m_division = division > 0 ? division : 120;
+    std::stable_sort(m_tempos.begin(), m_tempos.end(),
+        [](const TempoRec &a, const TempoRec &b) { return a.tick < b.tick; });
+    QVector<TempoRec> tempos;
+    tempos.reserve(m_tempos.count() + 1);
+    if (m_tempos.isEmpty() || m_tempos.first().tick > 0) {
+        tempos.append({ 0, DEFAULT_TEMPO, 0 });
+    }
+    foreach(const TempoRec &rec, m_tempos) {
+        if (!tempos.isEmpty() && tempos.last().tick == rec.tick) {
+            tempos.last().tempo = rec.tempo;
+        } else {
+            tempos.append(rec);
+        }
+    }
+    for (int i = 0; i < tempos.count(); ++i) {
+        if (i == 0) {
+            tempos[i].units = 0;
+        } else {
+            const TempoRec &prev = tempos.at(i - 1);
+            tempos[i].units = prev.units + (tempos.at(i).tick - prev.tick) * prev.tempo;
+        }
+    }
+    m_tempos = tempos;
+}
+
+int TempoMap::indexOfTick(qint64 ticks) const
+{
+    auto it = std::upper_bound(m_tempos.cbegin(), m_tempos.cend(), ticks,
+        [](qint64 t, const TempoRec &rec) { return t < rec.tick; });
+    return it == m_tempos.cbegin() ? 0 : int(it - m_tempos.cbegin()) - 1;
+}
+
+/**
+ * Converts musical time into real time.
+ * @param ticks Musical time.
+ * @return Real time in microseconds, rounded to the nearest.
+ */
+qint64 TempoMap::microsOfTicks(qint64 ticks) const
+{
+    if (m_tempos.isEmpty()) {
+        return (ticks * DEFAULT_TEMPO + m_division / 2) / m_division;
+    }
+    const TempoRec &rec = m_tempos.at(indexOfTick(ticks));
+    qint64 units = rec.units + (ticks - rec.tick) * rec.tempo;
+    return (units + m_division / 2) / m_division;
+}
+
+/**
+ * Converts real time into musical time.
+ * @param micros Real time in microseconds.
+ * @return The musical time in ticks, truncated.
+ */
+qint64 TempoMap::ticksOfMicros(qint64 micros) const
+{
+    qint64 units = micros * m_division;
+    if (m_tempos.isEmpty()) {
+        return units / DEFAULT_TEMPO;
+    }
+    auto it = std::upper_bound(m_tempos.cbegin(), m_tempos.cend(), units,
+        [](qint64 u, const TempoRec &rec) { return u < rec.units; });
+    const TempoRec &rec = (it == m_tempos.cbegin()) ? *it : *(it - 1);
+    return rec.tick + (units - rec.units) / rec.tempo;
+}
+
+/**
+ * Gets the tempo in effect at some musical time.
+ * @param ticks Musical time.
+ * @return Tempo in microseconds per quarter note.
+ */
+qint64 TempoMap::tempoAt(qint64 ticks) const
+{
+    if (m_tempos.isEmpty()) {
+        return DEFAULT_TEMPO;
+    }
+    return m_tempos.at(indexOfTick(ticks)).tempo;
+}
@@ -0,0 +1,65 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEMPOMAP_H
+#define TEMPOMAP_H
+
+#include <QtGlobal>
+#include <QVector>
+
+/**
+ * Tempo map of a song: a sorted array of tempo changes, with the
+ * accumulated time at each change, for exact conversions between
+ * musical time (ticks) and real time (microseconds) in O(log n).
+ *
+ * The accumulated time is kept in units of microseconds multiplied by
+ * the division (ticks per quarter note), so conversions are exact
+ * integer arithmetic without rounding errors piling up.
+ */
+class TempoMap
+{
+public:
+    static constexpr qint64 DEFAULT_TEMPO = 500000; ///< 120 BPM, as assumed by the SMF spec
+
+    struct TempoRec {
+        qint64 tick;
+        qint64 tempo;   ///< microseconds per quarter note
+        qint64 units;   ///< accumulated time at tick, microseconds * division
+    };
+
+    TempoMap();
+    void clear();
+    void addTempo(qint64 tick, qint64 tempo);
+    void build(int division);
+
+    qint64 microsOfTicks(qint64 ticks) const;
+    qint64 ticksOfMicros(qint64 micros) const;
+    qint64 tempoAt(qint64 ticks) const;
+
+    int count() const { return m_tempos.count(); }
+    const TempoRec& at(int i) const { return m_tempos.at(i); }
+    int division() const { return m_division; }
+
+private:
+    int indexOfTick(qint64 ticks) const;
+
+    QVector<TempoRec> m_tempos;
+    int m_division;
+};
+
+#endif // TEMPOMAP_H
@@ -0,0 +1,51 @@
+# Converts the test corpus with several sets of options, and compares the
+# channel events of the outputs with the golden events written by the
+# generator next to each input (song.events), using corpuscheck. The
+# outputs are decoded, so the check does not depend on the SMF encoding
+# of the Drumstick version in use.
+#
+# Variables: WRK2MID (program), CORPUSCHECK (program), CORPUS_DIR, WORK_DIR.
+
+cmake_minimum_required(VERSION 3.16)
+
+set(VARIANTS format1 format0 optimized ndjson)
+set(format1_ARGS --format 1)
+set(format0_ARGS --format 0)
+set(optimized_ARGS --optimize-size)
+set(optimized_CHECK --optimized)
+set(ndjson_ARGS --dump ndjson)
+
+file(GLOB INPUTS "${CORPUS_DIR}/*.wrk")
+list(SORT INPUTS)
+if (NOT INPUTS)
+    message(FATAL_ERROR "empty corpus: ${CORPUS_DIR}")
+endif()
+
+set(failed "")
+foreach(variant IN LISTS VARIANTS)
+    set(out "${WORK_DIR}/${variant}")
+    file(REMOVE_RECURSE "${out}")
+    execute_process(
+        COMMAND "${WRK2MID}" --jobs 2 --output-dir "${out}" ${${variant}_ARGS} ${INPUTS}
+        RESULT_VARIABLE rc
+        ERROR_VARIABLE errors
+    )
+    if (NOT rc EQUAL 0)
+        message(FATAL_ERROR "${variant}: wrk2mid failed (${rc}):\n${errors}")
+    endif()
+    execute_process(
+        COMMAND "${CORPUSCHECK}" ${${variant}_CHECK} "${CORPUS_DIR}" "${out}"
+        RESULT_VARIABLE rc
+        OUTPUT_VARIABLE summary
+        ERROR_VARIABLE report
+    )
+    string(STRIP "${summary}" summary)
+    message(STATUS "${variant}: ${summary}")
+    if (NOT rc EQUAL 0)
+        message("${variant}: events differ from the golden events:\n${report}")
+        list(APPEND failed ${variant})
+    endif()
+endforeach()
+if (failed)
+    message(FATAL_ERROR "outputs differ from the golden events: ${failed}")
+endif()
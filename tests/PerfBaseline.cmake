@@ -0,0 +1,93 @@
+# Measures the conversion throughput and peak memory of the test corpus,
+# and compares them with a baseline. The timings depend on the machine, so
+# the baseline is recorded by the first run in each build tree, and later
+# runs are compared with it. The best of several runs is used, after a
+# first run to warm the caches.
+#
+# Variables: WRK2MID (program), CORPUS_DIR, WORK_DIR, BASELINE (file),
+# TOLERANCE (percent), RUNS, RECORD (write the baseline instead of comparing).
+
+cmake_minimum_required(VERSION 3.16)
+
+if (NOT DEFINED TOLERANCE)
+    set(TOLERANCE 15)
+endif()
+if (NOT DEFINED RUNS)
+    set(RUNS 3)
+endif()
+
+if (NOT EXISTS "${BASELINE}")
+    set(RECORD ON)
+endif()
+
+file(GLOB INPUTS "${CORPUS_DIR}/*.wrk")
+list(SORT INPUTS)
+set(corpus_bytes 0)
+foreach(input IN LISTS INPUTS)
+    file(SIZE "${input}" size)
+    math(EXPR corpus_bytes "${corpus_bytes} + ${size}")
+endforeach()
+if (corpus_bytes EQUAL 0)
+    message(FATAL_ERROR "empty corpus: ${CORPUS_DIR}")
+endif()
+
+set(best_ms -1)
+set(best_rss -1)
+foreach(run RANGE ${RUNS})
+    file(REMOVE_RECURSE "${WORK_DIR}/out")
+    execute_process(
+        COMMAND "${WRK2MID}" --jobs 1 --stats --output-dir "${WORK_DIR}/out" ${INPUTS}
+        RESULT_VARIABLE rc
+        ERROR_VARIABLE stats
+    )
+    if (NOT rc EQUAL 0)
+        message(FATAL_ERROR "wrk2mid failed (${rc}):\n${stats}")
+    endif()
+    if (NOT stats MATCHES "elapsed: ([0-9]+)\\.([0-9][0-9][0-9]) s")
+        message(FATAL_ERROR "no elapsed time in the statistics:\n${stats}")
+    endif()
+    math(EXPR ms "${CMAKE_MATCH_1} * 1000 + 1${CMAKE_MATCH_2} - 1000")
+    set(rss 0)
+    if (stats MATCHES "peak memory: ([0-9]+) KiB")
+        set(rss ${CMAKE_MATCH_1})
+    endif()
+    if (run EQUAL 0)
+        continue()
+    endif()
+    if (best_ms LESS 0 OR ms LESS best_ms)
+        set(best_ms ${ms})
+    endif()
+    if (best_rss LESS 0 OR rss LESS best_rss)
+        set(best_rss ${rss})
+    endif()
+endforeach()
+if (best_ms LESS 1)
+    set(best_ms 1)
+endif()
+math(EXPR throughput "${corpus_bytes} * 1000 / 1024 / ${best_ms}")
+message(STATUS "corpus: ${corpus_bytes} bytes, ${best_ms} ms, ${throughput} KiB/s, peak memory ${best_rss} KiB")
+
+if (RECORD)
+    file(WRITE "${BASELINE}"
+        "# Performance baseline of the test corpus, recorded by PerfBaseline.cmake\n"
+        "set(BASELINE_THROUGHPUT_KIB_S ${throughput})\n"
+        "set(BASELINE_PEAK_MEMORY_KIB ${best_rss})\n")
+    message(STATUS "baseline recorded in ${BASELINE}; the next runs are compared with it")
+    return()
+endif()
+include("${BASELINE}")
+math(EXPR min_throughput "${BASELINE_THROUGHPUT_KIB_S} * (100 - ${TOLERANCE}) / 100")
+math(EXPR max_memory "${BASELINE_PEAK_MEMORY_KIB} * (100 + ${TOLERANCE}) / 100")
+set(failures "")
+if (throughput LESS min_throughput)
+    string(APPEND failures "throughput ${throughput} KiB/s is below ${min_throughput} "
+                           "(baseline ${BASELINE_THROUGHPUT_KIB_S} - ${TOLERANCE}%)\n")
+endif()
+if (best_rss GREATER 0 AND BASELINE_PEAK_MEMORY_KIB GREATER 0 AND best_rss GREATER max_memory)
+    string(APPEND failures "peak memory ${best_rss} KiB is above ${max_memory} "
+                           "(baseline ${BASELINE_PEAK_MEMORY_KIB} + ${TOLERANCE}%)\n")
+endif()
+if (failures)
+    message(FATAL_ERROR "performance regression:\n${failures}")
+endif()
+message(STATUS "performance within ${TOLERANCE}% of the baseline")
@@ -0,0 +1,331 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Compares the outputs of the conversion of a generated corpus with the
+ * channel events expected by the generator. The outputs, standard MIDI
+ * files or NDJSON dumps, are decoded here without Drumstick, so the check
+ * does not depend on the details of the encoding, only on the events and
+ * their times. With --optimized, controllers repeating their last value
+ * may have been removed, so the controllers found must be expected and
+ * never repeated, but the missing ones are not reported.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QtEndian>
+#include "wrkgenerator.h"
+
+static const int MAX_REPORTED = 10;
+
+static CorpusEvent canonical(qint64 tick, int status, int data1, int data2)
+{
+    int type = status & 0xf0;
+    if (type == 0x90 && data2 == 0) {
+        type = 0x80;
+    }
+    if (type == 0x80 || type == 0xc0 || type == 0xd0) {
+        data2 = 0;
+    }
+    return { tick, status & 0x0f, type, data1, data2 };
+}
+
+class SmfDecoder
+{
+public:
+    SmfDecoder(const QByteArray& data, bool checkRepeats) :
+        m_data(data), m_pos(0), m_checkRepeats(checkRepeats)
+    { }
+
+    bool decode(QList<CorpusEvent>* events);
+    QString errorString() const { return m_error; }
+
+private:
+    bool fail(const QString& error) { m_error = error; return false; }
+    bool readByte(int end, int* value);
+    bool readVarLen(int end, qint64* value);
+    bool decodeTrack(int end, QList<CorpusEvent>* events);
+
+    const QByteArray& m_data;
+    int m_pos;
+    bool m_checkRepeats;
+    QString m_error;
+};
+
+bool SmfDecoder::readByte(int end, int *value)
+{
+    if (m_pos >= end) {
+        return fail(QString("truncated track at offset %1").arg(m_pos));
+    }
+    *value = static_cast<uchar>(m_data[m_pos++]);
+    return true;
+}
+
+bool SmfDecoder::readVarLen(int end, qint64 *value)
+{
+    *value = 0;
+    for (int i = 0; i < 4; ++i) {
+        int byte;
+        if (!readByte(end, &byte)) {
+            return false;
+        }
+        *value = (*value << 7) | (byte & 0x7f);
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return fail(QString("variable length quantity too long at offset %1").arg(m_pos));
+}
+
+bool SmfDecoder::decode(QList<CorpusEvent> *events)
+{
+    if (m_data.size() < 14 || !m_data.startsWith("MThd")) {
+        return fail("not a standard MIDI file");
+    }
+    m_pos = 8 + qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(m_data.constData()) + 4);
+    while (m_pos + 8 <= m_data.size()) {
+        const QByteArray id = m_data.mid(m_pos, 4);
+        const qint64 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(m_data.constData()) + m_pos + 4);
+        m_pos += 8;
+        if (m_pos + length > m_data.size()) {
+            return fail("truncated chunk " + QString::fromLatin1(id));
+        }
+        const int end = m_pos + int(length);
+        if (id == "MTrk" && !decodeTrack(end, events)) {
+            return false;
+        }
+        m_pos = end;
+    }
+    return true;
+}
+
+bool SmfDecoder::decodeTrack(int end, QList<CorpusEvent> *events)
+{
+    QHash<int, int> lastValues;
+    qint64 tick = 0;
+    int running = 0;
+    while (m_pos < end) {
+        qint64 delta, length;
+        int status, data1, data2 = 0;
+        if (!readVarLen(end, &delta) || !readByte(end, &status)) {
+            return false;
+        }
+        tick += delta;
+        if (status < 0x80) {
+            if (running == 0) {
+                return fail(QString("running status without a previous message at offset %1").arg(m_pos));
+            }
+            data1 = status;
+            status = running;
+        } else if (status == 0xff) {
+            running = 0;
+            if (!readByte(end, &data1) || !readVarLen(end, &length)) {
+                return false;
+            }
+            m_pos += int(length);
+            continue;
+        } else if (status == 0xf0 || status == 0xf7) {
+            running = 0;
+            if (!readVarLen(end, &length)) {
+                return false;
+            }
+            m_pos += int(length);
+            continue;
+        } else if (!readByte(end, &data1)) {
+            return false;
+        }
+        running = status;
+        const int type = status & 0xf0;
+        if (type != 0xc0 && type != 0xd0 && !readByte(end, &data2)) {
+            return false;
+        }
+        if (m_checkRepeats && type == 0xb0) {
+            const int key = (status & 0x0f) * 128 + data1;
+            if (lastValues.value(key, -1) == data2) {
+                return fail(QString("controller %1 repeats the value %2 at tick %3").arg(data1).arg(data2).arg(tick));
+            }
+            lastValues.insert(key, data2);
+        }
+        events->append(canonical(tick, status, data1, data2));
+    }
+    if (m_pos != end) {
+        return fail("the last event exceeds the track");
+    }
+    return true;
+}
+
+static bool decodeNdjson(const QByteArray& data, QList<CorpusEvent>* events, QString* error)
+{
+    const QList<QByteArray> lines = data.split('\n');
+    foreach(const QByteArray& line, lines) {
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonParseError parseError;
+        const QJsonObject object = QJsonDocument::fromJson(line, &parseError).object();
+        if (parseError.error != QJsonParseError::NoError) {
+            *error = parseError.errorString();
+            return false;
+        }
+        if (!object.contains("channel")) {
+            continue;
+        }
+        const QJsonArray bytes = object.value("data").toArray();
+        events->append(canonical(object.value("tick").toVariant().toLongLong(),
+                                 object.value("status").toInt() | object.value("channel").toInt(),
+                                 bytes.at(0).toInt(), bytes.size() > 1 ? bytes.at(1).toInt() : 0));
+    }
+    return true;
+}
+
+/*
+ * Compares two sorted lists of events, reporting the differences.
+ * @param subset Only the events of the actual list missing in the
+ * expected one are differences.
+ */
+static bool compareEvents(const QList<CorpusEvent>& expected, const QList<CorpusEvent>& actual,
+                          bool subset, QByteArray* report)
+{
+    int differences = 0;
+    auto reportLine = [&](const char* kind, const CorpusEvent& ev) {
+        if (++differences <= MAX_REPORTED) {
+            *report += QByteArray("  ") + kind + ": " + ev.toLine();
+        }
+    };
+    int i = 0, j = 0;
+    while (i < expected.size() || j < actual.size()) {
+        if (j == actual.size() || (i < expected.size() && expected.at(i) < actual.at(j))) {
+            if (!subset) {
+                reportLine("missing", expected.at(i));
+            }
+            ++i;
+        } else if (i == expected.size() || actual.at(j) < expected.at(i)) {
+            reportLine("unexpected", actual.at(j));
+            ++j;
+        } else {
+            ++i;
+            ++j;
+        }
+    }
+    if (differences > MAX_REPORTED) {
+        *report += "  ... " + QByteArray::number(differences - MAX_REPORTED) + " more\n";
+    }
+    return differences == 0;
+}
+
+static void splitControllers(QList<CorpusEvent>& events, QList<CorpusEvent>* controllers)
+{
+    auto it = std::stable_partition(events.begin(), events.end(),
+                                    [](const CorpusEvent& ev) { return ev.status != 0xb0; });
+    std::copy(it, events.end(), std::back_inserter(*controllers));
+    events.erase(it, events.end());
+}
+
+static bool checkFile(const QString& expectedFile, const QString& outputFile, bool optimized, QByteArray* report)
+{
+    QFile file(expectedFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *report += "  cannot read " + expectedFile.toUtf8() + '\n';
+        return false;
+    }
+    QList<CorpusEvent> expected;
+    foreach(const QByteArray& line, file.readAll().split('\n')) {
+        CorpusEvent ev;
+        if (CorpusEvent::fromLine(line, &ev)) {
+            expected.append(ev);
+        }
+    }
+    file.close();
+
+    QFile output(outputFile);
+    if (!output.open(QIODevice::ReadOnly)) {
+        *report += "  missing output " + outputFile.toUtf8() + '\n';
+        return false;
+    }
+    const QByteArray data = output.readAll();
+    QList<CorpusEvent> actual;
+    QString error;
+    bool ok;
+    if (outputFile.endsWith(".ndjson")) {
+        ok = decodeNdjson(data, &actual, &error);
+    } else {
+        SmfDecoder decoder(data, optimized);
+        ok = decoder.decode(&actual);
+        error = decoder.errorString();
+    }
+    if (!ok) {
+        *report += "  " + error.toUtf8() + '\n';
+        return false;
+    }
+    std::sort(actual.begin(), actual.end());
+    if (!optimized) {
+        return compareEvents(expected, actual, false, report);
+    }
+    QList<CorpusEvent> expectedControllers, actualControllers;
+    splitControllers(expected, &expectedControllers);
+    splitControllers(actual, &actualControllers);
+    ok = compareEvents(expected, actual, false, report);
+    return compareEvents(expectedControllers, actualControllers, true, report) && ok;
+}
+
+int main(int argc, char *argv[])
+{
+    QStringList args;
+    for (int i = 1; i < argc; ++i) {
+        args += QString::fromLocal8Bit(argv[i]);
+    }
+    const bool optimized = args.removeAll("--optimized") > 0;
+    if (args.size() != 2) {
+        std::cerr << "usage: corpuscheck [--optimized] <corpus directory> <output directory>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const QDir corpusDir(args.at(0)), outputDir(args.at(1));
+    const QStringList names = corpusDir.entryList({ "*.events" }, QDir::Files, QDir::Name);
+    if (names.isEmpty()) {
+        std::cerr << "no expected events in " << args.at(0).toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+    int failures = 0;
+    foreach(const QString& name, names) {
+        const QString base = QFileInfo(name).completeBaseName();
+        QString outputFile = outputDir.filePath(base + ".mid");
+        if (!QFile::exists(outputFile)) {
+            outputFile = outputDir.filePath(base + ".ndjson");
+        }
+        QByteArray report;
+        if (!checkFile(corpusDir.filePath(name), outputFile, optimized, &report)) {
+            failures++;
+            std::cerr << base.toStdString() << ":\n" << report.constData();
+        }
+    }
+    std::cout << names.size() << " files checked, " << failures << " differ" << std::endl;
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,199 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QTemporaryDir>
+#include <QtTest>
+#include "archivereader.h"
+#include "archivewriter.h"
+
+class TestArchive : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void patterns_data();
+    void patterns();
+    void formatOf();
+    void extractErrors();
+
+private:
+    static bool writeArchive(const QString& fileName, const QList<QPair<QString, QByteArray>>& files);
+    static QStringList readNames(const QString& fileName, const QStringList& include, const QStringList& exclude);
+};
+
+bool TestArchive::writeArchive(const QString &fileName, const QList<QPair<QString, QByteArray>> &files)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    // a small buffer, to flush it several times
+    ArchiveWriter writer(&file, ArchiveWriter::formatOf(fileName), 1000);
+    for (const auto& f : files) {
+        if (!writer.addFile(f.first, f.second)) {
+            return false;
+        }
+    }
+    return writer.finish() && writer.bytesWritten() == file.size();
+}
+
+QStringList TestArchive::readNames(const QString &fileName, const QStringList &include, const QStringList &exclude)
+{
+    ArchiveReader reader(fileName);
+    reader.setPatterns(include, exclude);
+    QStringList names;
+    ArchiveMember member;
+    if (reader.open()) {
+        while (reader.next(member)) {
+            names.append(member.name);
+        }
+    }
+    if (reader.hasError()) {
+        names.append("error: " + reader.errorString());
+    }
+    return names;
+}
+
+void TestArchive::roundTrip_data()
+{
+    QTest::addColumn<QString>("suffix");
+    QTest::newRow("tar") << "tar";
+    QTest::newRow("zip") << "zip";
+}
+
+void TestArchive::roundTrip()
+{
+    QFETCH(QString, suffix);
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("songs." + suffix);
+    QByteArray binary;
+    for (int i = 0; i < 5000; ++i) {
+        binary += char(i * 7);
+    }
+    const QString longName = QString("long/") + QString(60, 'd') + '/' + QString(60, 'f') + ".wrk";
+    const QList<QPair<QString, QByteArray>> files {
+        { "a.wrk", binary },
+        { "dir/SONG.WRK", "upper case suffix" },
+        { "notes.txt", "not selected" },
+        { longName, "long name" },
+        { "empty.wrk", QByteArray() },
+    };
+    QVERIFY(writeArchive(fileName, files));
+
+    ArchiveReader reader(fileName);
+    QVERIFY(reader.open());
+    ArchiveMember member;
+    QStringList names;
+    foreach(const auto& f, files) {
+        if (f.first.endsWith(".txt")) {
+            continue;
+        }
+        QVERIFY2(reader.next(member), qPrintable(reader.errorString()));
+        QCOMPARE(member.name, f.first);
+        QCOMPARE(member.size, qint64(f.second.size()));
+        QCOMPARE(member.hasCrc, suffix == "zip");
+        QString error;
+        QCOMPARE(ArchiveReader::extract(member, &error), f.second);
+        QVERIFY(error.isEmpty());
+    }
+    QVERIFY(!reader.next(member));
+    QVERIFY(!reader.hasError());
+}
+
+void TestArchive::patterns_data()
+{
+    QTest::addColumn<QStringList>("include");
+    QTest::addColumn<QStringList>("exclude");
+    QTest::addColumn<QStringList>("names");
+    QTest::newRow("default") << QStringList() << QStringList()
+                             << QStringList({ "a.wrk", "drafts/b.wrk", "other/drafts/c.Wrk" });
+    QTest::newRow("file name") << QStringList({ "b*" }) << QStringList()
+                               << QStringList({ "drafts/b.wrk" });
+    QTest::newRow("path") << QStringList() << QStringList({ "drafts/*" })
+                          << QStringList({ "a.wrk", "other/drafts/c.Wrk" });
+    QTest::newRow("both") << QStringList({ "*.wrk", "*.txt" }) << QStringList({ "C.*" })
+                          << QStringList({ "a.wrk", "drafts/b.wrk", "readme.txt" });
+}
+
+void TestArchive::patterns()
+{
+    QFETCH(QStringList, include);
+    QFETCH(QStringList, exclude);
+    QFETCH(QStringList, names);
+    QTemporaryDir dir;
+    const QList<QPair<QString, QByteArray>> files {
+        { "a.wrk", "a" },
+        { "drafts/b.wrk", "b" },
+        { "other/drafts/c.Wrk", "c" },
+        { "readme.txt", "r" },
+    };
+    foreach(const QString& suffix, QStringList({ "tar", "zip" })) {
+        const QString fileName = dir.filePath("songs." + suffix);
+        QVERIFY(writeArchive(fileName, files));
+        QCOMPARE(readNames(fileName, include, exclude), names);
+    }
+}
+
+void TestArchive::formatOf()
+{
+    QVERIFY(ArchiveReader::isArchive("songs.ZIP"));
+    QVERIFY(ArchiveReader::isArchive("songs.tar"));
+    QVERIFY(!ArchiveReader::isArchive("songs.tar.gz"));
+    QVERIFY(!ArchiveReader::isArchive("song.wrk"));
+    QCOMPARE(ArchiveWriter::formatOf("out.Zip"), ArchiveWriter::Zip);
+    QCOMPARE(ArchiveWriter::formatOf("out.tar"), ArchiveWriter::Tar);
+    QCOMPARE(ArchiveWriter::formatOf("-"), ArchiveWriter::Tar);
+}
+
+void TestArchive::extractErrors()
+{
+    QString error;
+    ArchiveMember member;
+    member.name = "a.wrk";
+    member.data = "data";
+    member.size = 5;
+    QVERIFY(ArchiveReader::extract(member, &error).isEmpty());
+    QCOMPARE(error, QString("wrong member size"));
+
+    error.clear();
+    member.size = 4;
+    member.method = ArchiveReader::Encrypted;
+    QVERIFY(ArchiveReader::extract(member, &error).isEmpty());
+    QVERIFY(!error.isEmpty());
+
+    error.clear();
+    member.method = 12;
+    QVERIFY(ArchiveReader::extract(member, &error).isEmpty());
+    QVERIFY(!error.isEmpty());
+
+    // truncated archives are errors, not the end of the members
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("songs.tar");
+    QVERIFY(writeArchive(fileName, { { "a.wrk", QByteArray(2000, 'a') } }));
+    QFile file(fileName);
+    QVERIFY(file.resize(1000));
+    QStringList names = readNames(fileName, QStringList(), QStringList());
+    QCOMPARE(names.size(), 1);
+    QVERIFY(names.first().startsWith("error: "));
+}
+
+QTEST_GUILESS_MAIN(TestArchive)
+
+#include "tst_archive.moc"
@@ -0,0 +1,139 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCryptographicHash>
+#include <QTemporaryDir>
+#include <QtTest>
+#include "batchjournal.h"
+#include "sequence.h"
+
+class TestBatchJournal : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void statusNames();
+    void recordFormat();
+    void resume();
+    void failedRecordCancels();
+    void incompleteLine();
+
+private:
+    static QByteArray hash(const QByteArray& data)
+    {
+        return QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+    }
+    static QByteArray readFile(const QString& fileName)
+    {
+        QFile file(fileName);
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    }
+};
+
+void TestBatchJournal::statusNames()
+{
+    QCOMPARE(QByteArray(BatchJournal::statusName(Sequence::ReturnSuccess)), QByteArray("ok"));
+    QCOMPARE(QByteArray(BatchJournal::statusName(Sequence::ReturnFailure)), QByteArray("failed"));
+    QCOMPARE(QByteArray(BatchJournal::statusName(Sequence::ReturnLimitExceeded)), QByteArray("limit"));
+    QCOMPARE(QByteArray(BatchJournal::statusName(Sequence::ReturnSalvaged)), QByteArray("salvaged"));
+}
+
+void TestBatchJournal::recordFormat()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("journal.tsv");
+    BatchJournal journal(fileName);
+    QVERIFY(journal.open());
+    journal.append({ "/in/a.wrk", hash("a"), hash("A"), Sequence::ReturnSuccess, 1000000, 2500000, 3000 });
+    QVERIFY(journal.flush());
+    const QList<QByteArray> lines = readFile(fileName).split('\n');
+    QCOMPARE(lines.size(), 3);
+    QVERIFY(lines.at(0).startsWith("# path\t"));
+    QCOMPARE(lines.at(1), "/in/a.wrk\t" + hash("a").toHex() + '\t' + hash("A").toHex() + "\tok\t1.000\t2.500\t0.003");
+    QVERIFY(lines.at(2).isEmpty());
+}
+
+void TestBatchJournal::resume()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("journal.tsv");
+    {
+        BatchJournal journal(fileName);
+        QVERIFY(journal.open());
+        QCOMPARE(journal.completedCount(), 0);
+        journal.append({ "/in/a.wrk", hash("a"), hash("A"), Sequence::ReturnSuccess, 0, 0, 0 });
+        journal.append({ "/in/b.wrk", hash("b"), QByteArray(), Sequence::ReturnFailure, 0, 0, 0 });
+        journal.append({ "/in/c\td\\e\n.wrk", hash("c"), hash("C"), Sequence::ReturnSalvaged, 0, 0, 0 });
+        QVERIFY(journal.flush());
+    }
+    BatchJournal journal(fileName);
+    QVERIFY(journal.open());
+    QCOMPARE(journal.completedCount(), 2);
+    QVERIFY(journal.isCompleted("/in/a.wrk", hash("a")));
+    QVERIFY(!journal.isCompleted("/in/a.wrk", hash("changed")));
+    QVERIFY(!journal.isCompleted("/in/a.wrk", QByteArray()));
+    QVERIFY(!journal.isCompleted("/in/b.wrk", hash("b")));
+    QVERIFY(journal.isCompleted("/in/c\td\\e\n.wrk", hash("c")));
+    QVERIFY(!journal.isCompleted("/in/other.wrk", hash("a")));
+}
+
+void TestBatchJournal::failedRecordCancels()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("journal.tsv");
+    {
+        BatchJournal journal(fileName);
+        QVERIFY(journal.open());
+        journal.append({ "/in/a.wrk", hash("a"), hash("A"), Sequence::ReturnSuccess, 0, 0, 0 });
+        journal.append({ "/in/a.wrk", hash("a"), QByteArray(), Sequence::ReturnFailure, 0, 0, 0 });
+        QVERIFY(journal.flush());
+    }
+    BatchJournal journal(fileName);
+    QVERIFY(journal.open());
+    QVERIFY(!journal.isCompleted("/in/a.wrk", hash("a")));
+}
+
+void TestBatchJournal::incompleteLine()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("journal.tsv");
+    const QByteArray complete = "/in/a.wrk\t" + hash("a").toHex() + '\t' + hash("A").toHex() + "\tok\t1\t1\t1\n";
+    {
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(complete + "/in/b.wrk\t" + hash("b").toHex());
+    }
+    {
+        BatchJournal journal(fileName);
+        QVERIFY(journal.open());
+        QCOMPARE(journal.completedCount(), 1);
+        journal.append({ "/in/b.wrk", hash("b"), hash("B"), Sequence::ReturnSuccess, 0, 0, 0 });
+        QVERIFY(journal.flush());
+    }
+    const QList<QByteArray> lines = readFile(fileName).split('\n');
+    QCOMPARE(lines.size(), 4);
+    QCOMPARE(lines.at(1), "/in/b.wrk\t" + hash("b").toHex());
+    QVERIFY(lines.at(2).startsWith("/in/b.wrk\t"));
+    BatchJournal journal(fileName);
+    QVERIFY(journal.open());
+    QVERIFY(journal.isCompleted("/in/b.wrk", hash("b")));
+}
+
+QTEST_GUILESS_MAIN(TestBatchJournal)
+
+#include "tst_batchjournal.moc"
@@ -0,0 +1,165 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDir>
+#include <QTemporaryDir>
+#include <QtTest>
+#include "catalog.h"
+#include "sequence.h"
+#include "wrkgenerator.h"
+
+class TestCatalog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void update();
+    void persistence();
+    void incremental();
+    void query();
+
+private:
+    bool writeSong(const QString& name, quint64 seed, int size);
+    QString songPath(const QString& name) const;
+
+    QScopedPointer<QTemporaryDir> m_dir;
+    QString m_songs;
+    QString m_index;
+};
+
+void TestCatalog::init()
+{
+    m_dir.reset(new QTemporaryDir);
+    m_songs = m_dir->filePath("songs");
+    m_index = m_dir->filePath("test.catalog");
+    QVERIFY(QDir().mkpath(m_songs + "/more"));
+    QVERIFY(writeSong("a.wrk", 1, 20));
+    QVERIFY(writeSong("more/b.wrk", 2, 20));
+    QVERIFY(writeSong("notes.txt", 3, 20));
+}
+
+bool TestCatalog::writeSong(const QString &name, quint64 seed, int size)
+{
+    QFile file(m_songs + '/' + name);
+    const QByteArray data = generateWrkFile(seed, size);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+QString TestCatalog::songPath(const QString &name) const
+{
+    return QFileInfo(m_songs + '/' + name).canonicalFilePath();
+}
+
+void TestCatalog::update()
+{
+    Sequence seq;
+    Catalog catalog(m_index);
+    QVERIFY(catalog.load());
+    QCOMPARE(catalog.update({ m_songs }, seq), 2);
+    QCOMPARE(catalog.removedCount(), 0);
+    const QList<const Catalog::Entry*> entries = catalog.query(QString());
+    QCOMPARE(entries.size(), 2);
+    QCOMPARE(entries.at(0)->path, songPath("a.wrk"));
+    QCOMPARE(entries.at(1)->path, songPath("more/b.wrk"));
+    foreach(const Catalog::Entry* entry, entries) {
+        QCOMPARE(entry->status, int(Sequence::ReturnSuccess));
+        QCOMPARE(entry->size, QFileInfo(entry->path).size());
+        QCOMPARE(entry->hash.size(), 32);
+        QVERIFY(entry->division > 0);
+        QVERIFY(entry->events > 0);
+        QVERIFY(entry->duration > 0);
+        QVERIFY(!entry->tempos.isEmpty());
+        QVERIFY(!entry->trackNames.isEmpty());
+    }
+}
+
+void TestCatalog::persistence()
+{
+    Sequence seq;
+    {
+        Catalog catalog(m_index);
+        QVERIFY(catalog.load());
+        catalog.update({ m_songs }, seq);
+        QVERIFY(catalog.save());
+    }
+    Catalog catalog(m_index);
+    QVERIFY(catalog.load());
+    const QList<const Catalog::Entry*> entries = catalog.query(QString());
+    QCOMPARE(entries.size(), 2);
+    QCOMPARE(entries.at(0)->path, songPath("a.wrk"));
+    QVERIFY(!entries.at(0)->meters.isEmpty());
+
+    QFile file(m_index);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write("garbage");
+    file.close();
+    QVERIFY(!catalog.load());
+    QVERIFY(catalog.query(QString()).isEmpty());
+}
+
+void TestCatalog::incremental()
+{
+    Sequence seq;
+    Catalog catalog(m_index);
+    QCOMPARE(catalog.update({ m_songs }, seq), 2);
+    // unchanged files are not scanned again
+    QCOMPARE(catalog.update({ m_songs }, seq), 0);
+    QCOMPARE(catalog.removedCount(), 0);
+
+    const QByteArray hash = catalog.query("path=a.wrk").first()->hash;
+    QVERIFY(writeSong("a.wrk", 4, 200));
+    QCOMPARE(catalog.update({ m_songs }, seq), 1);
+    QVERIFY(catalog.query("path=a.wrk").first()->hash != hash);
+
+    QVERIFY(QFile::remove(m_songs + "/more/b.wrk"));
+    QCOMPARE(catalog.update({ m_songs }, seq), 0);
+    QCOMPARE(catalog.removedCount(), 1);
+    QCOMPARE(catalog.query(QString()).size(), 1);
+
+    // files outside the given paths are kept
+    QVERIFY(writeSong("more/c.wrk", 5, 20));
+    QCOMPARE(catalog.update({ m_songs + "/more/c.wrk" }, seq), 1);
+    QCOMPARE(catalog.removedCount(), 0);
+    QCOMPARE(catalog.query(QString()).size(), 2);
+}
+
+void TestCatalog::query()
+{
+    Sequence seq;
+    Catalog catalog(m_index);
+    catalog.update({ m_songs }, seq);
+    const Catalog::Entry* a = catalog.query("path=a.wrk").first();
+
+    bool ok = false;
+    QCOMPARE(catalog.query("track=track 1", &ok).size(), 2);
+    QVERIFY(ok);
+    QCOMPARE(catalog.query("path=more/").size(), 1);
+    QCOMPARE(catalog.query("status=0").size(), 2);
+    QVERIFY(catalog.query("timebase=" + QString::number(a->division)).contains(a));
+    QCOMPARE(catalog.query("hash=" + QString::fromLatin1(a->hash.toHex().left(12))), QList<const Catalog::Entry*>({ a }));
+    QCOMPARE(catalog.query("path=a.wrk,path=more/").size(), 0);
+    QVERIFY(catalog.query("title=no such title").isEmpty());
+
+    QVERIFY(catalog.query("wrong", &ok).isEmpty());
+    QVERIFY(!ok);
+}
+
+QTEST_GUILESS_MAIN(TestCatalog)
+
+#include "tst_catalog.moc"
@@ -0,0 +1,103 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include "metermap.h"
+
+class TestMeterMap : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void defaultMeter();
+    void meterChanges();
+    void roundTrip();
+    void keySignatures();
+
+private:
+    static void addChanges(MeterMap& map);
+};
+
+// 4/4 at bar 0, 3/4 at bar 2 and 6/8 at bar 5, added out of order
+void TestMeterMap::addChanges(MeterMap& map)
+{
+    map.addTimeSignature(5, 6, 8);
+    map.addTimeSignature(0, 4, 4);
+    map.addTimeSignature(2, 2, 4);
+    map.addTimeSignature(2, 3, 4);  // the last one at the same bar wins
+    map.build(120);
+}
+
+void TestMeterMap::defaultMeter()
+{
+    MeterMap map;
+    map.build(120);
+    QCOMPARE(map.timeSignatures(), 0);
+    QCOMPARE(map.barToTick(3), qint64(1440));
+    QCOMPARE(map.tickToBar(1439), 2);
+    QCOMPARE(map.tickToBar(1440), 3);
+}
+
+void TestMeterMap::meterChanges()
+{
+    MeterMap map;
+    addChanges(map);
+    QCOMPARE(map.timeSignatures(), 3);
+    QCOMPARE(map.timeSignature(0).tick, qint64(0));
+    QCOMPARE(map.timeSignature(1).num, 3);
+    QCOMPARE(map.timeSignature(1).tick, qint64(960));
+    QCOMPARE(map.timeSignature(2).tick, qint64(2040));
+    QCOMPARE(map.barLength(map.timeSignature(0)), qint64(480));
+    QCOMPARE(map.barLength(map.timeSignature(1)), qint64(360));
+    QCOMPARE(map.barLength(map.timeSignature(2)), qint64(360));
+    QCOMPARE(map.barToTick(1), qint64(480));
+    QCOMPARE(map.barToTick(3), qint64(1320));
+    QCOMPARE(map.barToTick(7), qint64(2760));
+    QCOMPARE(map.tickToBar(959), 1);
+    QCOMPARE(map.tickToBar(960), 2);
+    QCOMPARE(map.tickToBar(2039), 4);
+    QCOMPARE(map.tickToBar(2040), 5);
+    QCOMPARE(map.tickToBar(2759), 6);
+}
+
+void TestMeterMap::roundTrip()
+{
+    MeterMap map;
+    addChanges(map);
+    for (int bar = 1; bar < 20; ++bar) {
+        qint64 tick = map.barToTick(bar);
+        QCOMPARE(map.tickToBar(tick), bar);
+        QCOMPARE(map.tickToBar(tick - 1), bar - 1);
+    }
+}
+
+void TestMeterMap::keySignatures()
+{
+    MeterMap map;
+    map.addKeySignature(5, -2);
+    map.addKeySignature(3, 1);
+    addChanges(map);
+    QCOMPARE(map.keySignatures(), 2);
+    QCOMPARE(map.keySignature(0).alterations, 1);
+    QCOMPARE(map.keySignature(0).tick, qint64(1320));
+    QCOMPARE(map.keySignature(1).tick, qint64(2040));
+}
+
+QTEST_GUILESS_MAIN(TestMeterMap)
+
+#include "tst_metermap.moc"
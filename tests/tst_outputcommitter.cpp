@@ -0,0 +1,215 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDir>
+#include <QTemporaryDir>
+#include <QtTest>
+#include "outputcommitter.h"
+#if defined(Q_OS_UNIX)
+#include <sys/stat.h>
+#endif
+
+class TestOutputCommitter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void parseDurability_data();
+    void parseDurability();
+    void writeFile_data();
+    void writeFile();
+    void replaceFile();
+    void missingDirectory();
+    void groupCommit();
+    void groupFull();
+    void groupFailed();
+    void permissions();
+
+private:
+    static QByteArray readFile(const QString& fileName)
+    {
+        QFile file(fileName);
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    }
+    static QStringList entries(const QTemporaryDir& dir)
+    {
+        return QDir(dir.path()).entryList(QDir::Files | QDir::Hidden, QDir::Name);
+    }
+};
+
+void TestOutputCommitter::initTestCase()
+{
+#if defined(Q_OS_UNIX)
+    // the umask is read by the first committer
+    ::umask(022);
+#endif
+}
+
+void TestOutputCommitter::parseDurability_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<int>("durability");
+    QTest::newRow("none") << "none" << true << int(OutputCommitter::DurabilityNone);
+    QTest::newRow("file") << " File " << true << int(OutputCommitter::DurabilityFile);
+    QTest::newRow("group") << "GROUP" << true << int(OutputCommitter::DurabilityGroup);
+    QTest::newRow("invalid") << "always" << false << -1;
+    QTest::newRow("empty") << "" << false << -1;
+}
+
+void TestOutputCommitter::parseDurability()
+{
+    QFETCH(QString, text);
+    QFETCH(bool, valid);
+    QFETCH(int, durability);
+    OutputCommitter::Durability result = OutputCommitter::DurabilityNone;
+    QCOMPARE(OutputCommitter::parseDurability(text, &result), valid);
+    if (valid) {
+        QCOMPARE(int(result), durability);
+    }
+}
+
+void TestOutputCommitter::writeFile_data()
+{
+    QTest::addColumn<int>("durability");
+    QTest::newRow("none") << int(OutputCommitter::DurabilityNone);
+    QTest::newRow("file") << int(OutputCommitter::DurabilityFile);
+}
+
+void TestOutputCommitter::writeFile()
+{
+    QFETCH(int, durability);
+    QTemporaryDir dir;
+    OutputCommitter committer(OutputCommitter::Durability(durability));
+    const QString fileName = dir.filePath("song.mid");
+    QStringList failed;
+    QVERIFY(committer.write(fileName, "MThd", &failed));
+    QVERIFY(failed.isEmpty());
+    QCOMPARE(committer.pendingFiles(), 0);
+    QCOMPARE(readFile(fileName), QByteArray("MThd"));
+    // no temporary files are left behind
+    QCOMPARE(entries(dir), QStringList({ "song.mid" }));
+}
+
+void TestOutputCommitter::replaceFile()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("song.mid");
+    OutputCommitter committer;
+    QVERIFY(committer.write(fileName, "first version"));
+    QVERIFY(committer.write(fileName, "second"));
+    QCOMPARE(readFile(fileName), QByteArray("second"));
+    QCOMPARE(entries(dir), QStringList({ "song.mid" }));
+}
+
+void TestOutputCommitter::missingDirectory()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("missing/song.mid");
+    OutputCommitter committer;
+    QStringList failed;
+    QVERIFY(!committer.write(fileName, "MThd", &failed));
+    QCOMPARE(failed, QStringList({ fileName }));
+    QVERIFY(!committer.errorString().isEmpty());
+}
+
+void TestOutputCommitter::groupCommit()
+{
+    QTemporaryDir dir;
+    OutputCommitter committer(OutputCommitter::DurabilityGroup);
+    QVERIFY(committer.write(dir.filePath("a.mid"), "a"));
+    QVERIFY(committer.write(dir.filePath("b.mid"), "b"));
+    QCOMPARE(committer.pendingFiles(), 2);
+#if defined(Q_OS_UNIX)
+    // the files are invisible until their group is committed
+    QVERIFY(!QFile::exists(dir.filePath("a.mid")));
+    QVERIFY(!QFile::exists(dir.filePath("b.mid")));
+#endif
+    QStringList failed;
+    QVERIFY(committer.commit(&failed));
+    QVERIFY(failed.isEmpty());
+    QCOMPARE(committer.pendingFiles(), 0);
+    QCOMPARE(readFile(dir.filePath("a.mid")), QByteArray("a"));
+    QCOMPARE(readFile(dir.filePath("b.mid")), QByteArray("b"));
+    QCOMPARE(entries(dir), QStringList({ "a.mid", "b.mid" }));
+}
+
+void TestOutputCommitter::groupFull()
+{
+#if defined(Q_OS_UNIX)
+    QTemporaryDir dir;
+    {
+        OutputCommitter committer(OutputCommitter::DurabilityGroup, 2, 1024);
+        QVERIFY(committer.write(dir.filePath("a.mid"), "a"));
+        QCOMPARE(committer.pendingFiles(), 1);
+        QVERIFY(committer.write(dir.filePath("b.mid"), "b"));
+        QCOMPARE(committer.pendingFiles(), 0);
+        QVERIFY(QFile::exists(dir.filePath("a.mid")));
+        QVERIFY(committer.write(dir.filePath("c.mid"), QByteArray(1024, 'c')));
+        QCOMPARE(committer.pendingFiles(), 0);
+        QVERIFY(QFile::exists(dir.filePath("c.mid")));
+        QVERIFY(committer.write(dir.filePath("d.mid"), "d"));
+        QCOMPARE(committer.pendingFiles(), 1);
+    }
+    // the destructor commits the last group
+    QVERIFY(QFile::exists(dir.filePath("d.mid")));
+#else
+    QSKIP("files are committed as they are written on this system");
+#endif
+}
+
+void TestOutputCommitter::groupFailed()
+{
+#if defined(Q_OS_UNIX)
+    QTemporaryDir dir;
+    OutputCommitter committer(OutputCommitter::DurabilityGroup);
+    QVERIFY(committer.write(dir.filePath("a.mid"), "a"));
+    QVERIFY(committer.write(dir.filePath("b.mid"), "b"));
+    // lose the temporary files of the group
+    foreach(const QString& entry, entries(dir)) {
+        QVERIFY(QFile::remove(dir.filePath(entry)));
+    }
+    QStringList failed;
+    QVERIFY(!committer.commit(&failed));
+    QCOMPARE(failed, QStringList({ dir.filePath("a.mid"), dir.filePath("b.mid") }));
+    QVERIFY(!committer.errorString().isEmpty());
+    QVERIFY(entries(dir).isEmpty());
+#else
+    QSKIP("files are committed as they are written on this system");
+#endif
+}
+
+void TestOutputCommitter::permissions()
+{
+#if defined(Q_OS_UNIX)
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("song.mid");
+    OutputCommitter committer;
+    QVERIFY(committer.write(fileName, "MThd"));
+    const QFile::Permissions expected = QFile::ReadOwner | QFile::WriteOwner | QFile::ReadUser | QFile::WriteUser |
+            QFile::ReadGroup | QFile::ReadOther;
+    QCOMPARE(QFile::permissions(fileName), expected);
+#else
+    QSKIP("permissions are not set on this system");
+#endif
+}
+
+QTEST_GUILESS_MAIN(TestOutputCommitter)
+
+#include "tst_outputcommitter.moc"
@@ -0,0 +1,88 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include "tempomap.h"
+
+class TestTempoMap : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void defaultTempo();
+    void tempoChanges();
+    void sameTickLastWins();
+    void noDrift();
+};
+
+void TestTempoMap::defaultTempo()
+{
+    TempoMap map;
+    map.build(480);
+    QCOMPARE(map.count(), 1);
+    QCOMPARE(map.tempoAt(100000), TempoMap::DEFAULT_TEMPO);
+    QCOMPARE(map.microsOfTicks(480), qint64(500000));
+    QCOMPARE(map.ticksOfMicros(1000000), qint64(960));
+}
+
+void TestTempoMap::tempoChanges()
+{
+    TempoMap map;
+    map.addTempo(960, 1000000);
+    map.addTempo(0, 500000);
+    map.addTempo(480, 0);   // ignored
+    map.build(480);
+    QCOMPARE(map.count(), 2);
+    QCOMPARE(map.tempoAt(959), qint64(500000));
+    QCOMPARE(map.tempoAt(960), qint64(1000000));
+    QCOMPARE(map.microsOfTicks(960), qint64(1000000));
+    QCOMPARE(map.microsOfTicks(1440), qint64(2000000));
+    // one tick at 120 BPM is 1041.67 microseconds, rounded to the nearest
+    QCOMPARE(map.microsOfTicks(1), qint64(1042));
+    QCOMPARE(map.ticksOfMicros(1000000), qint64(960));
+    QCOMPARE(map.ticksOfMicros(1500000), qint64(1200));
+}
+
+void TestTempoMap::sameTickLastWins()
+{
+    TempoMap map;
+    map.addTempo(480, 400000);
+    map.addTempo(480, 600000);
+    map.build(96);
+    // the default tempo is inserted before the first change
+    QCOMPARE(map.count(), 2);
+    QCOMPARE(map.at(0).tempo, TempoMap::DEFAULT_TEMPO);
+    QCOMPARE(map.tempoAt(480), qint64(600000));
+    QCOMPARE(map.division(), 96);
+}
+
+void TestTempoMap::noDrift()
+{
+    TempoMap map;
+    for (int i = 0; i < 1000; ++i) {
+        map.addTempo(i * 1000, 500001);
+    }
+    map.build(480);
+    // exact: 1000000 * 500001 / 480 microseconds
+    QCOMPARE(map.microsOfTicks(1000000), qint64(1041668750));
+    QCOMPARE(map.ticksOfMicros(1041668750), qint64(1000000));
+}
+
+QTEST_GUILESS_MAIN(TestTempoMap)
+
+#include "tst_tempomap.moc"
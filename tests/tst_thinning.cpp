@@ -0,0 +1,142 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include "thinning.h"
+
+typedef QPair<long, int> Point;
+
+class TestThinning : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rampWithinError();
+    void rampSpacing();
+    void switchesUntouched();
+    void pitchBendScaled();
+
+private:
+    static EventsList controllerRamp(int cc, int count, int step, QVector<Point>& points);
+    static int heldAt(const EventsList& list, long tick);
+};
+
+EventsList TestThinning::controllerRamp(int cc, int count, int step, QVector<Point>& points)
+{
+    EventsList list;
+    for (int i = 0; i < count; ++i) {
+        ControllerEvent* ev = new ControllerEvent(0, cc, i);
+        ev->setTick(i * step);
+        list.append(ev);
+        points.append(qMakePair(long(i * step), i));
+    }
+    return list;
+}
+
+int TestThinning::heldAt(const EventsList& list, long tick)
+{
+    int held = -1;
+    foreach(MIDIEvent* ev, list) {
+        if (ev->tick() > tick) {
+            break;
+        }
+        held = ev->status() == MIDIEvent::MIDI_STATUS_PITCHBEND ?
+                    static_cast<PitchBendEvent*>(ev)->value() :
+                    static_cast<ControllerEvent*>(ev)->value();
+    }
+    return held;
+}
+
+void TestThinning::rampWithinError()
+{
+    QVector<Point> points;
+    EventsList list = controllerRamp(ControllerEvent::MIDI_CTL_MSB_MAIN_VOLUME, 128, 10, points);
+    ControllerThinner thinner(4, 0);
+    QVERIFY(thinner.thin(list));
+    QCOMPARE(thinner.inputEvents(), qint64(128));
+    QCOMPARE(thinner.outputEvents(), qint64(list.size()));
+    QVERIFY(list.size() * 100 <= 128 * 30);
+    QCOMPARE(list.first()->tick(), 0L);
+    QCOMPARE(list.last()->tick(), 1270L);
+    foreach(const Point& p, points) {
+        QVERIFY(qAbs(heldAt(list, p.first) - p.second) <= 4);
+    }
+    qDeleteAll(list);
+}
+
+void TestThinning::rampSpacing()
+{
+    QVector<Point> points;
+    EventsList list = controllerRamp(ControllerEvent::MIDI_CTL_MSB_MAIN_VOLUME, 128, 10, points);
+    ControllerThinner thinner(0, 40);
+    QVERIFY(thinner.thin(list));
+    for (int i = 1; i < list.size() - 1; ++i) {
+        QVERIFY(list.at(i)->tick() - list.at(i - 1)->tick() >= 40);
+    }
+    // a change is delayed by the spacing at most
+    foreach(const Point& p, points) {
+        QVERIFY(heldAt(list, p.first + 40) >= p.second);
+    }
+    qDeleteAll(list);
+}
+
+void TestThinning::switchesUntouched()
+{
+    EventsList list;
+    for (int i = 0; i < 120; ++i) {
+        int cc = ControllerEvent::MIDI_CTL_SUSTAIN + i % 6;
+        ControllerEvent* ev = new ControllerEvent(0, cc, (i / 6) % 2 ? 127 : 0);
+        ev->setTick(i);
+        list.append(ev);
+    }
+    // a pedal stream repeating the same value is not thinned either
+    for (int i = 0; i < 50; ++i) {
+        ControllerEvent* ev = new ControllerEvent(1, ControllerEvent::MIDI_CTL_SUSTAIN, 127);
+        ev->setTick(i);
+        list.append(ev);
+    }
+    ControllerThinner thinner(127, 1000);
+    QVERIFY(!thinner.thin(list));
+    QCOMPARE(list.size(), 170);
+    QCOMPARE(thinner.inputEvents(), qint64(0));
+    qDeleteAll(list);
+}
+
+void TestThinning::pitchBendScaled()
+{
+    EventsList list;
+    QVector<Point> points;
+    for (int i = 0; i < 128; ++i) {
+        PitchBendEvent* ev = new PitchBendEvent(0, i * 64);
+        ev->setTick(i);
+        list.append(ev);
+        points.append(qMakePair(long(i), i * 64));
+    }
+    ControllerThinner thinner(1, 0);
+    QVERIFY(thinner.thin(list));
+    // one 7 bits unit is 128 pitch bend units: one event out of three is kept
+    QCOMPARE(list.size(), 44);
+    foreach(const Point& p, points) {
+        QVERIFY(qAbs(heldAt(list, p.first) - p.second) <= 128);
+    }
+    qDeleteAll(list);
+}
+
+QTEST_GUILESS_MAIN(TestThinning)
+
+#include "tst_thinning.moc"
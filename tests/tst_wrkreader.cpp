@@ -0,0 +1,193 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QBuffer>
+#include <QtEndian>
+#include <QtTest>
+#include "wrkreader.h"
+#include "wrkgenerator.h"
+
+class TestWrkReader : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void allRecords();
+    void stopEarly();
+    void ignoredChunks();
+    void sysexPort();
+
+private:
+    static void putChunk(QByteArray& file, WrkChunkId id, const QByteArray& chunk);
+    static QByteArray putInt(quint32 value, int bytes);
+};
+
+QByteArray TestWrkReader::putInt(quint32 value, int bytes)
+{
+    uchar buf[4];
+    qToLittleEndian<quint32>(value, buf);
+    return QByteArray(reinterpret_cast<const char*>(buf), bytes);
+}
+
+void TestWrkReader::putChunk(QByteArray &file, WrkChunkId id, const QByteArray &chunk)
+{
+    file.append(putInt(static_cast<quint8>(id), 1));
+    file.append(putInt(chunk.size(), 4));
+    file.append(chunk);
+}
+
+void TestWrkReader::allRecords()
+{
+    QList<CorpusEvent> expected;
+    QByteArray data = generateWrkFile(7, 500, &expected);
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    WrkReader reader(&buffer);
+    QVERIFY(reader.readHeader());
+    QCOMPARE(reader.majorVersion(), 2);
+    QMap<int, int> counts, expectedCounts;
+    foreach(const CorpusEvent& ev, expected) {
+        expectedCounts[ev.status]++;
+    }
+    int timeBase = 0, meters = 0;
+    WrkRecordType last = WrkRecordType::None;
+    while (reader.next()) {
+        const WrkRecord& rec = reader.record();
+        switch (rec.type) {
+        case WrkRecordType::Note:
+            counts[0x90]++;
+            break;
+        case WrkRecordType::Controller:
+            counts[0xb0]++;
+            break;
+        case WrkRecordType::Program:
+            counts[0xc0]++;
+            break;
+        case WrkRecordType::PitchBend:
+            counts[0xe0]++;
+            QVERIFY(rec.value >= -8192 && rec.value <= 8191);
+            break;
+        case WrkRecordType::TimeBase:
+            timeBase = rec.value;
+            break;
+        case WrkRecordType::TimeSignature:
+            meters++;
+            break;
+        default:
+            break;
+        }
+        last = rec.type;
+    }
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+    QVERIFY(last == WrkRecordType::End);
+    QCOMPARE(reader.pos(), qint64(data.size()));
+    QVERIFY(timeBase > 0);
+    QCOMPARE(meters, 2);
+    QCOMPARE(counts.value(0x90), expectedCounts.value(0x90));
+    QCOMPARE(counts.value(0xb0), expectedCounts.value(0xb0));
+    QCOMPARE(counts.value(0xc0), expectedCounts.value(0xc0));
+    QCOMPARE(counts.value(0xe0), expectedCounts.value(0xe0));
+}
+
+void TestWrkReader::stopEarly()
+{
+    QByteArray data = generateWrkFile(11, 2000);
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    WrkReader reader(&buffer);
+    QVERIFY(reader.readHeader());
+    bool found = false;
+    while (!found && reader.next()) {
+        found = reader.record().type == WrkRecordType::Note;
+    }
+    QVERIFY(found);
+    QCOMPARE(reader.record().chunkId, int(WrkChunkId::Stream));
+    QCOMPARE(reader.record().track, 0);
+    // only the chunks before the first note, and the first events, are read
+    QVERIFY(reader.pos() < data.size() / 2);
+    QCOMPARE(buffer.pos(), reader.pos());
+    // the rest of the track is skipped
+    reader.skipChunk();
+    QVERIFY(reader.next());
+    QVERIFY(reader.record().chunkId != int(WrkChunkId::Stream) || reader.record().track != 0);
+}
+
+void TestWrkReader::ignoredChunks()
+{
+    QByteArray data = generateWrkFile(13, 500);
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    WrkReader reader(&buffer);
+    reader.setChunkIgnored(WrkChunkId::Stream);
+    reader.setChunkIgnored(WrkChunkId::Track);
+    QVERIFY(reader.readHeader());
+    int tempos = 0, meters = 0;
+    while (reader.next()) {
+        const WrkRecord& rec = reader.record();
+        QVERIFY(rec.chunkId != int(WrkChunkId::Stream) && rec.chunkId != int(WrkChunkId::Track));
+        QVERIFY(rec.type != WrkRecordType::Chunk);
+        if (rec.type == WrkRecordType::Tempo) {
+            tempos++;
+        } else if (rec.type == WrkRecordType::TimeSignature) {
+            meters++;
+        }
+    }
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+    QVERIFY(reader.record().type == WrkRecordType::End);
+    QVERIFY(tempos > 0);
+    QCOMPARE(meters, 2);
+}
+
+void TestWrkReader::sysexPort()
+{
+    const QByteArray message("\xf0\x7e\x7f\x09\x01\xf7", 6);
+    QByteArray data("CAKEWALK\x1a\x00\x02", WRK_HEADER_SIZE);
+    QByteArray chunk = putInt(5, 2) + putInt(message.size(), 4) + putInt(0x31, 1)
+            + putInt(5, 1) + "GM on" + message;
+    putChunk(data, WrkChunkId::Sysex2, chunk);
+    chunk = putInt(6, 2) + putInt(message.size(), 4) + putInt(9, 2) + putInt(0, 1)
+            + putInt(0, 1) + message;
+    putChunk(data, WrkChunkId::NewSysex, chunk);
+    data.append(putInt(static_cast<quint8>(WrkChunkId::End), 1));
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    WrkReader reader(&buffer);
+    QVERIFY(reader.readHeader());
+    QVERIFY(reader.next());
+    QVERIFY(reader.record().type == WrkRecordType::Sysex);
+    QCOMPARE(reader.record().value, 5);
+    QCOMPARE(reader.record().data1, 1);     // autosend
+    QCOMPARE(reader.record().data2, 3);     // port
+    QCOMPARE(reader.record().name, QByteArray("GM on"));
+    QCOMPARE(reader.record().data, message);
+    QVERIFY(reader.next());
+    QVERIFY(reader.record().type == WrkRecordType::Sysex);
+    QCOMPARE(reader.record().value, 6);
+    QCOMPARE(reader.record().data1, 0);
+    QCOMPARE(reader.record().data2, 9);
+    QVERIFY(reader.record().name.isEmpty());
+    QCOMPARE(reader.record().data, message);
+    QVERIFY(reader.next());
+    QVERIFY(reader.record().type == WrkRecordType::End);
+    QVERIFY(!reader.next());
+}
+
+QTEST_GUILESS_MAIN(TestWrkReader)
+
+#include "tst_wrkreader.moc"
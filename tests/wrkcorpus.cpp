@@ -0,0 +1,73 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Generator of a deterministic corpus of WRK files for the regression
+ * and performance tests: the same arguments produce the same files on
+ * every machine. Each song.wrk file is accompanied by song.events, the
+ * channel events that its conversion must produce, one per line.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QString>
+#include "wrkgenerator.h"
+
+static bool writeFile(const QString& fileName, const QByteArray& data)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+        std::cerr << "cannot write file: " << fileName.toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        std::cerr << "usage: wrkcorpus <directory> [files] [seed]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    QDir dir(QString::fromLocal8Bit(argv[1]));
+    const int files = argc > 2 ? std::atoi(argv[2]) : 200;
+    const quint64 seed = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1;
+    if (!dir.mkpath(".")) {
+        std::cerr << "cannot create directory: " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < files; ++i) {
+        // mostly small songs, and every tenth one a large one
+        int size = (i % 10 == 9) ? 20000 : 2000;
+        QString name = QString("song%1").arg(i, 4, 10, QChar('0'));
+        QList<CorpusEvent> expected;
+        QByteArray wrk = generateWrkFile(seed * 100003 + i, size, &expected);
+        QByteArray events;
+        foreach(const CorpusEvent& ev, expected) {
+            events += ev.toLine();
+        }
+        if (!writeFile(dir.filePath(name + ".wrk"), wrk) ||
+            !writeFile(dir.filePath(name + ".events"), events)) {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
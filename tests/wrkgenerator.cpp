@@ -0,0 +1,271 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <tuple>
+#include <QtEndian>
+#include "wrkgenerator.h"
+
+bool CorpusEvent::operator<(const CorpusEvent &other) const
+{
+    return std::tie(tick, channel, status, data1, data2) <
+            std::tie(other.tick, other.channel, other.status, other.data1, other.data2);
+}
+
+bool CorpusEvent::operator==(const CorpusEvent &other) const
+{
+    return std::tie(tick, channel, status, data1, data2) ==
+            std::tie(other.tick, other.channel, other.status, other.data1, other.data2);
+}
+
+/**
+ * The event as a line of text: tick, channel, status, data1 and data2.
+ */
+QByteArray CorpusEvent::toLine() const
+{
+    return QByteArray::number(tick) + ' ' + QByteArray::number(channel) + ' '
+            + QByteArray::number(status) + ' ' + QByteArray::number(data1) + ' '
+            + QByteArray::number(data2) + '\n';
+}
+
+bool CorpusEvent::fromLine(const QByteArray &line, CorpusEvent *event)
+{
+    const QList<QByteArray> fields = line.simplified().split(' ');
+    if (fields.size() != 5) {
+        return false;
+    }
+    bool ok[5];
+    event->tick = fields[0].toLongLong(&ok[0]);
+    event->channel = fields[1].toInt(&ok[1]);
+    event->status = fields[2].toInt(&ok[2]);
+    event->data1 = fields[3].toInt(&ok[3]);
+    event->data2 = fields[4].toInt(&ok[4]);
+    return ok[0] && ok[1] && ok[2] && ok[3] && ok[4];
+}
+
+class Random
+{
+public:
+    explicit Random(quint64 seed) : m_state(seed * 2654435761u + 1) { }
+    quint32 next()
+    {
+        // xorshift64*
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        return static_cast<quint32>((m_state * 2685821657736338717ULL) >> 32);
+    }
+    int range(int low, int high) { return low + static_cast<int>(next() % quint32(high - low + 1)); }
+
+private:
+    quint64 m_state;
+};
+
+static void put8(QByteArray& data, int value)
+{
+    data.append(static_cast<char>(value & 0xff));
+}
+
+static void put16(QByteArray& data, int value)
+{
+    uchar buf[2];
+    qToLittleEndian<quint16>(value, buf);
+    data.append(reinterpret_cast<const char*>(buf), 2);
+}
+
+static void put24(QByteArray& data, int value)
+{
+    put16(data, value & 0xffff);
+    put8(data, value >> 16);
+}
+
+static void put32(QByteArray& data, quint32 value)
+{
+    uchar buf[4];
+    qToLittleEndian<quint32>(value, buf);
+    data.append(reinterpret_cast<const char*>(buf), 4);
+}
+
+static void putChunk(QByteArray& file, int id, const QByteArray& chunk)
+{
+    put8(file, id);
+    put32(file, chunk.size());
+    file.append(chunk);
+}
+
+struct StreamEvent {
+    int time;
+    int status;
+    int data1;
+    int data2;
+    int duration;
+};
+
+/*
+ * The events of a WRK stream record in the converted song: notes have a
+ * note-on and a note-off event, at the end of their duration.
+ */
+static void addExpected(const StreamEvent& ev, QList<CorpusEvent>* expected)
+{
+    const int type = ev.status & 0xf0, channel = ev.status & 0x0f;
+    switch (type) {
+    case 0x90:
+        expected->append({ ev.time, channel, 0x90, ev.data1, ev.data2 });
+        expected->append({ ev.time + ev.duration, channel, 0x80, ev.data1, 0 });
+        break;
+    case 0xc0:
+    case 0xd0:
+        expected->append({ ev.time, channel, type, ev.data1, 0 });
+        break;
+    default:
+        expected->append({ ev.time, channel, type, ev.data1, ev.data2 });
+        break;
+    }
+}
+
+static QByteArray trackChunk(int track, const QByteArray& name, int channel)
+{
+    QByteArray chunk;
+    put16(chunk, track);
+    put8(chunk, name.size());
+    chunk.append(name);
+    put8(chunk, 0);
+    put8(chunk, channel);
+    put8(chunk, 0);     // pitch
+    put8(chunk, 0);     // velocity
+    put8(chunk, 0);     // port
+    put8(chunk, 0);     // flags
+    return chunk;
+}
+
+static QList<StreamEvent> trackEvents(Random& rnd, int channel, int timebase, int count)
+{
+    QList<StreamEvent> events;
+    events.append({ 0, 0xc0 | channel, rnd.range(0, 127), 0, 0 });
+    events.append({ 0, 0xb0 | channel, 7, rnd.range(64, 127), 0 });
+    int time = 0;
+    while (events.size() < count) {
+        switch (rnd.range(0, 9)) {
+        case 0: {   // controller ramp
+            int ctl = rnd.range(0, 2) == 0 ? 1 : (rnd.range(0, 1) ? 10 : 11);
+            int value = rnd.range(0, 127), step = rnd.range(-4, 4);
+            for (int i = 0; i < 32 && events.size() < count; ++i) {
+                events.append({ time + i * timebase / 32, 0xb0 | channel, ctl, qBound(0, value + i * step, 127), 0 });
+            }
+            break;
+        }
+        case 1: {   // pitch bend ramp, back to the center
+            int bend = rnd.range(-8192, 8191);
+            for (int i = 0; i <= 16 && events.size() < count; ++i) {
+                int value = 8192 + bend * (16 - i) / 16;
+                events.append({ time + i * timebase / 16, 0xe0 | channel, value & 0x7f, value >> 7, 0 });
+            }
+            break;
+        }
+        default: {  // chord or single note
+            int notes = rnd.range(0, 3) == 0 ? rnd.range(2, 4) : 1;
+            int duration = timebase * rnd.range(1, 8) / 4;
+            for (int i = 0; i < notes && events.size() < count; ++i) {
+                events.append({ time, 0x90 | channel, rnd.range(36, 96), rnd.range(1, 127), duration });
+            }
+            time += timebase * rnd.range(1, 4) / 2;
+            break;
+        }
+        }
+    }
+    std::stable_sort(events.begin(), events.end(), [](const StreamEvent& a, const StreamEvent& b) {
+        return a.time < b.time;
+    });
+    return events;
+}
+
+/**
+ * Generates a WRK file. The same seed produces the same file on every
+ * machine, with varied sizes, timebases, tempo and meter changes, notes,
+ * controllers and pitch bend.
+ * @param seed The seed of the random numbers.
+ * @param size The maximum number of events of each track.
+ * @param expected If not null, receives the channel events that the
+ * conversion of the file must produce, sorted.
+ */
+QByteArray generateWrkFile(quint64 seed, int size, QList<CorpusEvent>* expected)
+{
+    Random rnd(seed);
+    const int timebases[] = { 96, 120, 192, 240, 480, 960 };
+    const int timebase = timebases[rnd.range(0, 5)];
+    QByteArray file("CAKEWALK\x1a", 9);
+    put8(file, 0);
+    put8(file, 2);
+
+    QByteArray chunk;
+    put16(chunk, timebase);
+    putChunk(file, 10, chunk);
+
+    chunk.clear();
+    int tempos = rnd.range(1, 8);
+    put16(chunk, tempos);
+    for (int i = 0; i < tempos; ++i) {
+        put32(chunk, i * timebase * 16);
+        put32(chunk, 0);
+        put16(chunk, rnd.range(4000, 18000));
+        chunk.append(8, '\0');
+    }
+    putChunk(file, 15, chunk);
+
+    chunk.clear();
+    put16(chunk, 2);
+    const int meters[2][3] = { { 0, 4, 2 }, { 8, rnd.range(2, 7), rnd.range(2, 3) } };
+    for (const auto& meter : meters) {
+        put32(chunk, 0);
+        put16(chunk, meter[0]);
+        put8(chunk, meter[1]);
+        put8(chunk, meter[2]);
+        put32(chunk, 0);
+    }
+    putChunk(file, 5, chunk);
+
+    const int tracks = rnd.range(1, 16);
+    for (int track = 0; track < tracks; ++track) {
+        int channel = track % 16;
+        putChunk(file, 1, trackChunk(track, "Track " + QByteArray::number(track + 1), channel));
+        QList<StreamEvent> events = trackEvents(rnd, channel, timebase, rnd.range(size / 4, size));
+        for (int first = 0; first < events.size(); first += 0xffff) {
+            int count = qMin(events.size() - first, 0xffff);
+            chunk.clear();
+            put16(chunk, track);
+            put16(chunk, count);
+            for (int i = first; i < first + count; ++i) {
+                const StreamEvent& ev = events.at(i);
+                if (expected != nullptr) {
+                    addExpected(ev, expected);
+                }
+                put24(chunk, ev.time);
+                put8(chunk, ev.status);
+                put8(chunk, ev.data1);
+                put8(chunk, ev.data2);
+                put16(chunk, ev.duration);
+            }
+            putChunk(file, 2, chunk);
+        }
+    }
+    put8(file, 0xff);
+    if (expected != nullptr) {
+        std::sort(expected->begin(), expected->end());
+    }
+    return file;
+}
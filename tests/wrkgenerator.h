@@ -0,0 +1,47 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WRKGENERATOR_H
+#define WRKGENERATOR_H
+
+#include <QByteArray>
+#include <QList>
+#include <QtGlobal>
+
+/**
+ * A channel event of a converted song, in the canonical form compared by
+ * the corpus tests: note-on events with velocity zero are note-off events,
+ * note-off events have velocity zero, and single byte messages have zero
+ * as their second data byte.
+ */
+struct CorpusEvent {
+    qint64 tick;
+    int channel;
+    int status;     ///< the message type, from 0x80 to 0xe0
+    int data1;
+    int data2;
+
+    bool operator<(const CorpusEvent& other) const;
+    bool operator==(const CorpusEvent& other) const;
+    QByteArray toLine() const;
+    static bool fromLine(const QByteArray& line, CorpusEvent* event);
+};
+
+QByteArray generateWrkFile(quint64 seed, int size, QList<CorpusEvent>* expected = nullptr);
+
+#endif // WRKGENERATOR_H
@@ -0,0 +1,157 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QHash>
+#include <QVector>
+#include "thinning.h"
+
+static const int PITCHBEND_KEY = 128;
+
+ControllerThinner::ControllerThinner(int maxError, int minSpacing) :
+    m_maxError(maxError),
+    m_minSpacing(minSpacing),
+    m_input(0),
+    m_output(0)
+{ }
+
+bool ControllerThinner::isThinnable(MIDIEvent *ev)
+{
+    if (!ev->isChannel()) {
+        return false;
+    }
+    if (ev->status() == MIDIEvent::MIDI_STATUS_PITCHBEND) {
+        return true;
+    }
+    if (ev->status() == MIDIEvent::MIDI_STATUS_CONTROLCHANGE) {
+        int param = static_cast<ControllerEvent*>(ev)->param() & 0x7f;
+        return param != ControllerEvent::MIDI_CTL_MSB_BANK &&
+               param != ControllerEvent::MIDI_CTL_MSB_DATA_ENTRY &&
+               (param < ControllerEvent::MIDI_CTL_LSB_BANK || param > 0x3f) &&
+               (param < ControllerEvent::MIDI_CTL_SUSTAIN || param > ControllerEvent::MIDI_CTL_HOLD2) &&
+               (param < ControllerEvent::MIDI_CTL_DATA_INCREMENT ||
+                param > ControllerEvent::MIDI_CTL_REGIST_PARM_NUM_MSB) &&
+               param < ControllerEvent::MIDI_CTL_ALL_SOUNDS_OFF;
+    }
+    return false;
+}
+
+static int valueOf(MIDIEvent *ev)
+{
+    if (ev->status() == MIDIEvent::MIDI_STATUS_PITCHBEND) {
+        return static_cast<PitchBendEvent*>(ev)->value();
+    }
+    return static_cast<ControllerEvent*>(ev)->value();
+}
+
+void ControllerThinner::simplify(const EventsList& list, const QVector<int>& stream, QVector<bool>& removed)
+{
+    const int n = stream.size();
+    if (n < 3) {
+        return;
+    }
+    MIDIEvent* first = list.at(stream.first());
+    const int maxError = (first->status() == MIDIEvent::MIDI_STATUS_PITCHBEND) ?
+                m_maxError * 128 : m_maxError;
+    // the receiver holds the value of the last kept event until the next one
+    QVector<bool> keep(n, false);
+    keep[0] = true;
+    int held = valueOf(first);
+    long heldTick = first->tick();
+    // a change too close to the last kept event waits for the spacing
+    int pending = -1;
+    long changed = 0;
+    for (int i = 1; i < n; ++i) {
+        MIDIEvent* ev = list.at(stream[i]);
+        const int value = valueOf(ev);
+        const bool spaced = ev->tick() - heldTick >= m_minSpacing;
+        if (pending >= 0 && (spaced || i == n - 1)) {
+            if (ev->tick() - changed > m_minSpacing) {
+                // waiting until this event would delay the change too long
+                keep[pending] = true;
+                held = valueOf(list.at(stream[pending]));
+                heldTick = list.at(stream[pending])->tick();
+            }
+            pending = -1;
+        }
+        if (i == n - 1) {
+            keep[i] = true;
+        } else if (qAbs(value - held) <= maxError) {
+            pending = -1;
+        } else if (ev->tick() - heldTick < m_minSpacing) {
+            if (pending < 0) {
+                changed = ev->tick();
+            }
+            pending = i;
+        } else {
+            keep[i] = true;
+            held = value;
+            heldTick = ev->tick();
+        }
+    }
+    for (int i = 1; i < n - 1; ++i) {
+        if (!keep[i]) {
+            removed[stream[i]] = true;
+        }
+    }
+}
+
+/**
+ * Thins the controller streams of a sorted track.
+ * The removed events are deleted, and the deltas are not recalculated.
+ * @param list The events of a track.
+ * @return true if some event was removed.
+ */
+bool ControllerThinner::thin(EventsList& list)
+{
+    QHash<int, QVector<int>> streams;
+    qint64 streamed = 0;
+    for (int i = 0; i < list.size(); ++i) {
+        MIDIEvent* ev = list.at(i);
+        if (isThinnable(ev)) {
+            int chan = static_cast<ChannelEvent*>(ev)->channel();
+            int ctl = ev->status() == MIDIEvent::MIDI_STATUS_PITCHBEND ?
+                        PITCHBEND_KEY : static_cast<ControllerEvent*>(ev)->param() & 0x7f;
+            streams[chan * 256 + ctl].append(i);
+            streamed++;
+        }
+    }
+    m_input += streamed;
+    if (streams.isEmpty()) {
+        return false;
+    }
+    QVector<bool> removed(list.size(), false);
+    for (auto it = streams.cbegin(); it != streams.cend(); ++it) {
+        simplify(list, it.value(), removed);
+    }
+    EventsList kept;
+    kept.reserve(list.size());
+    qint64 count = 0;
+    for (int i = 0; i < list.size(); ++i) {
+        if (removed[i]) {
+            delete list.at(i);
+            count++;
+        } else {
+            kept.append(list.at(i));
+        }
+    }
+    m_output += streamed - count;
+    if (count > 0) {
+        list = kept;
+    }
+    return count > 0;
+}
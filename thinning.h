@@ -0,0 +1,62 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef THINNING_H
+#define THINNING_H
+
+#include <QtGlobal>
+#include "events.h"
+
+typedef QList<MIDIEvent*> EventsList;
+
+/**
+ * Lossy reduction of dense controller and pitch bend streams.
+ *
+ * Each stream (track, channel and controller) is simplified against the
+ * value held by the receiver, which is the value of the last kept event:
+ * an event is removed when its value is within the maximum error of the
+ * held value. A change closer than the minimum spacing to the last kept
+ * event waits until the spacing, so it may be delayed by up to the
+ * spacing, or skipped if the value comes back within that time. The
+ * first and last events of each stream are always kept.
+ *
+ * The maximum error is given in 7 bits units, and scaled for the 14 bits
+ * of pitch bend. Controllers that are not continuous values (bank select,
+ * data entry, RPN/NRPN, LSB of 14 bits pairs, the switches 64 to 69 like
+ * the sustain pedal, and channel mode messages) are never thinned.
+ */
+class ControllerThinner
+{
+public:
+    ControllerThinner(int maxError, int minSpacing);
+    bool thin(EventsList& list);
+    qint64 inputEvents() const { return m_input; }
+    qint64 outputEvents() const { return m_output; }
+
+    static bool isThinnable(MIDIEvent* ev);
+
+private:
+    void simplify(const EventsList& list, const QVector<int>& stream, QVector<bool>& removed);
+
+    int m_maxError;
+    int m_minSpacing;
+    qint64 m_input;
+    qint64 m_output;
+};
+
+#endif // THINNING_H
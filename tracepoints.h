@@ -0,0 +1,74 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACEPOINTS_H
+#define TRACEPOINTS_H
+
+#include <atomic>
+#include <QtGlobal>
+
+/**
+ * Receiver of the spans recorded by the conversion library.
+ *
+ * The library does not write traces itself: a program installs a sink,
+ * like the Chrome trace recorder of the command line utility (Tracer).
+ * Without a sink, a span costs one relaxed atomic load.
+ */
+class TraceSink
+{
+public:
+    virtual ~TraceSink() = default;
+    virtual qint64 now() = 0;
+    virtual void complete(const char* name, qint64 start, qint64 end, int track) = 0;
+
+    static TraceSink* current() { return s_current.load(std::memory_order_relaxed); }
+    static void install(TraceSink* sink) { s_current.store(sink); }
+
+private:
+    static inline std::atomic<TraceSink*> s_current { nullptr };
+};
+
+/**
+ * A span from its construction to its destruction.
+ */
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name, int track = -1) :
+        m_sink(TraceSink::current()),
+        m_name(name),
+        m_track(track),
+        m_start(m_sink != nullptr ? m_sink->now() : 0)
+    { }
+    ~TraceSpan()
+    {
+        if (m_sink != nullptr) {
+            m_sink->complete(m_name, m_start, m_sink->now(), m_track);
+        }
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    TraceSink* m_sink;
+    const char* m_name;
+    int m_track;
+    qint64 m_start;
+};
+
+#endif // TRACEPOINTS_H
@@ -0,0 +1,208 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include "tracer.h"
+
+std::atomic<bool> Tracer::s_enabled(false);
+
+namespace {
+
+const int BUFFER_SIZE = 64 * 1024;
+
+QMutex s_mutex;
+QFile* s_file = nullptr;
+qint64 s_origin = 0;
+std::atomic<int> s_nextThread(1);
+
+void appendToFile(QByteArray& data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+    QMutexLocker locker(&s_mutex);
+    if (s_file != nullptr) {
+        s_file->write(data);
+    }
+    data.resize(0);
+}
+
+struct ThreadBuffer {
+    QByteArray data;
+    QByteArray file;
+    int thread = s_nextThread++;
+
+    ~ThreadBuffer() { appendToFile(data); }
+};
+
+thread_local ThreadBuffer t_buffer;
+
+class RecorderSink : public TraceSink
+{
+public:
+    qint64 now() override { return Tracer::now(); }
+    void complete(const char* name, qint64 start, qint64 end, int track) override
+    {
+        Tracer::complete(name, start, end, track);
+    }
+};
+
+RecorderSink s_sink;
+
+QByteArray jsonEscape(const QString& text)
+{
+    QByteArray utf8 = text.toUtf8();
+    QByteArray result;
+    result.reserve(utf8.size());
+    for (char c : utf8) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<uchar>(c) < 0x20) {
+            char buf[8];
+            qsnprintf(buf, sizeof(buf), "\\u%04x", c);
+            result += buf;
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+}
+
+/**
+ * Starts recording to a new trace file.
+ * @return false if the file cannot be created.
+ */
+bool Tracer::start(const QString &fileName)
+{
+    QMutexLocker locker(&s_mutex);
+    if (s_file != nullptr) {
+        return false;
+    }
+    s_file = new QFile(fileName);
+    if (!s_file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        delete s_file;
+        s_file = nullptr;
+        return false;
+    }
+    s_file->write("[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"wrk2mid\"}}");
+    s_origin = now();
+    s_enabled = true;
+    TraceSink::install(&s_sink);
+    return true;
+}
+
+/**
+ * Stops recording, and closes the trace file. The buffers of other
+ * threads still running are lost, so it should be called after they end.
+ */
+bool Tracer::stop()
+{
+    flush();
+    QMutexLocker locker(&s_mutex);
+    TraceSink::install(nullptr);
+    s_enabled = false;
+    if (s_file == nullptr) {
+        return false;
+    }
+    s_file->write("\n]\n");
+    bool ok = s_file->error() == QFileDevice::NoError;
+    s_file->close();
+    delete s_file;
+    s_file = nullptr;
+    return ok;
+}
+
+/**
+ * Writes the buffer of the calling thread to the trace file.
+ */
+void Tracer::flush()
+{
+    appendToFile(t_buffer.data);
+    QMutexLocker locker(&s_mutex);
+    if (s_file != nullptr) {
+        s_file->flush();
+    }
+}
+
+/**
+ * @return A monotonic time in nanoseconds.
+ */
+qint64 Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Records a complete span of the calling thread.
+ * @param name A string literal, not escaped.
+ * @param start The start time, from now().
+ * @param end The end time, from now().
+ * @param track The track number, or -1.
+ */
+void Tracer::complete(const char *name, qint64 start, qint64 end, int track)
+{
+    if (!isEnabled()) {
+        return;
+    }
+    ThreadBuffer& buffer = t_buffer;
+    char event[256];
+    int len = qsnprintf(event, sizeof(event),
+                        ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{",
+                        name, (start - s_origin) / 1e3, (end - start) / 1e3, buffer.thread);
+    buffer.data.append(event, qBound(0, len, int(sizeof(event)) - 1));
+    if (track >= 0) {
+        len = qsnprintf(event, sizeof(event), "\"track\":%d,", track);
+        buffer.data.append(event, len);
+    }
+    buffer.data += "\"file\":\"" + buffer.file + "\"}}";
+    if (buffer.data.size() >= BUFFER_SIZE) {
+        appendToFile(buffer.data);
+    }
+}
+
+/**
+ * Names the calling thread in the trace.
+ */
+void Tracer::setThreadName(const char *name)
+{
+    if (!isEnabled()) {
+        return;
+    }
+    char event[160];
+    int len = qsnprintf(event, sizeof(event),
+                        ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                        t_buffer.thread, name);
+    t_buffer.data.append(event, qBound(0, len, int(sizeof(event)) - 1));
+}
+
+/**
+ * Sets the file recorded by the next spans of the calling thread.
+ */
+void Tracer::setFile(const QString &fileName)
+{
+    if (isEnabled()) {
+        t_buffer.file = jsonEscape(fileName);
+    }
+}
@@ -0,0 +1,55 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <QtGlobal>
+#include <QString>
+#include "tracepoints.h"
+
+/**
+ * Recorder of Chrome trace events (JSON), viewable in Perfetto or
+ * chrome://tracing.
+ *
+ * Spans are formatted into per thread buffers without locking, and
+ * appended to the trace file when a buffer is full, when its thread ends,
+ * or by flush(). While recording, it is installed as the TraceSink of the
+ * conversion library. When tracing is not started, a span costs one
+ * relaxed atomic load. Each span records the file set for its thread by
+ * setFile().
+ */
+class Tracer
+{
+public:
+    static bool start(const QString& fileName);
+    static bool stop();
+    static void flush();
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    static qint64 now();
+    static void complete(const char* name, qint64 start, qint64 end, int track = -1);
+    static void setThreadName(const char* name);
+    static void setFile(const QString& fileName);
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+#endif // TRACER_H
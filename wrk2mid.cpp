@@ -0,0 +1,159 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <limits>
+#include <new>
+#include <QByteArray>
+#include "sequence.h"
+#include "wrk2mid.h"
+
+struct wrk2mid_converter {
+    Sequence seq;
+    QByteArray output;
+    QByteArray messages;
+    int result = WRK2MID_OK;
+    qint64 inputSize = 0;
+};
+
+const char* wrk2mid_version(void)
+{
+    return QT_STRINGIFY(VERSION);
+}
+
+wrk2mid_converter* wrk2mid_create(void)
+{
+    return new (std::nothrow) wrk2mid_converter;
+}
+
+int wrk2mid_set_option(wrk2mid_converter* conv, wrk2mid_option option, long long value)
+{
+    if (conv == nullptr || value < 0) {
+        return WRK2MID_ERROR;
+    }
+    Sequence::Limits limits = conv->seq.limits();
+    switch (option) {
+    case WRK2MID_OPT_FORMAT:
+        if (value > 1) {
+            return WRK2MID_ERROR;
+        }
+        conv->seq.setOutputFormat(static_cast<int>(value));
+        break;
+    case WRK2MID_OPT_OPTIMIZE_SIZE:
+        conv->seq.setOptimizeSize(value != 0);
+        break;
+    case WRK2MID_OPT_SALVAGE:
+        conv->seq.setSalvage(value != 0);
+        break;
+    case WRK2MID_OPT_MAX_EVENTS:
+        limits.maxEvents = value;
+        break;
+    case WRK2MID_OPT_MAX_MEMORY:
+        limits.maxMemory = value;
+        break;
+    case WRK2MID_OPT_MAX_SYSEX_BYTES:
+        limits.maxSysexBytes = value;
+        break;
+    case WRK2MID_OPT_MAX_TICKS:
+        limits.maxTicks = value;
+        break;
+    case WRK2MID_OPT_TIMEOUT_MS:
+        limits.timeout = value;
+        break;
+    default:
+        return WRK2MID_ERROR;
+    }
+    conv->seq.setLimits(limits);
+    return WRK2MID_OK;
+}
+
+int wrk2mid_convert(wrk2mid_converter* conv, const void* data, size_t size)
+{
+    if (conv == nullptr || (data == nullptr && size > 0) ||
+        size > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        return WRK2MID_ERROR;
+    }
+    conv->output.clear();
+    conv->messages.clear();
+    conv->inputSize = static_cast<qint64>(size);
+    try {
+        conv->seq.loadData(QByteArray::fromRawData(static_cast<const char*>(data), static_cast<int>(size)));
+        if (conv->seq.hasSong()) {
+            conv->output = conv->seq.saveData();
+        }
+        conv->result = conv->seq.returnCode();
+        if (conv->seq.hasSong() && conv->output.isEmpty()) {
+            conv->result = WRK2MID_ERROR;
+        }
+        conv->messages = conv->seq.messages().join('\n').toUtf8();
+    } catch (...) {
+        conv->seq.clear();
+        conv->output.clear();
+        conv->messages = "internal error";
+        conv->result = WRK2MID_ERROR;
+    }
+    return conv->result;
+}
+
+const void* wrk2mid_output(const wrk2mid_converter* conv, size_t* size)
+{
+    if (conv == nullptr || conv->output.isEmpty()) {
+        if (size != nullptr) {
+            *size = 0;
+        }
+        return nullptr;
+    }
+    if (size != nullptr) {
+        *size = static_cast<size_t>(conv->output.size());
+    }
+    return conv->output.constData();
+}
+
+const char* wrk2mid_messages(const wrk2mid_converter* conv)
+{
+    if (conv == nullptr) {
+        return "";
+    }
+    return conv->messages.constData();
+}
+
+int wrk2mid_get_stats(const wrk2mid_converter* conv, wrk2mid_stats* stats)
+{
+    if (conv == nullptr || stats == nullptr || stats->struct_size < sizeof(size_t)) {
+        return WRK2MID_ERROR;
+    }
+    wrk2mid_stats s;
+    std::memset(&s, 0, sizeof(s));
+    s.struct_size = qMin(stats->struct_size, sizeof(wrk2mid_stats));
+    s.result = conv->result;
+    s.format = conv->seq.getFormat();
+    s.division = conv->seq.getDivision();
+    s.tracks = conv->seq.tracks().size();
+    s.events = conv->seq.eventCount();
+    s.ticks = conv->seq.songLengthTicks();
+    s.duration_us = s.division > 0 ? conv->seq.durationMicros() : 0;
+    s.input_size = conv->inputSize;
+    s.output_size = conv->output.size();
+    std::memcpy(stats, &s, s.struct_size);
+    return WRK2MID_OK;
+}
+
+void wrk2mid_free(wrk2mid_converter* conv)
+{
+    delete conv;
+}
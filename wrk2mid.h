@@ -0,0 +1,102 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WRK2MID_H
+#define WRK2MID_H
+
+/*
+ * C interface of the wrk2mid conversion library.
+ *
+ * A converter translates WRK songs held in memory into SMF data, also in
+ * memory. A converter may be reused for any number of conversions, but
+ * it must not be used by more than one thread at the same time. Distinct
+ * converters can be used concurrently. The library prints nothing: the
+ * diagnostics of each conversion are returned by wrk2mid_messages().
+ *
+ * This interface is stable: functions and constants are only added, and
+ * the stats structure only grows at the end. Callers set its struct_size
+ * member before calling wrk2mid_get_stats().
+ */
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#  if defined(WRK2MID_SHARED_EXPORT)
+#    define WRK2MID_API __declspec(dllexport)
+#  elif defined(WRK2MID_SHARED)
+#    define WRK2MID_API __declspec(dllimport)
+#  else
+#    define WRK2MID_API
+#  endif
+#else
+#  define WRK2MID_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Result codes, the same as the exit status of the command line utility */
+#define WRK2MID_OK              0   /* converted */
+#define WRK2MID_ERROR           1   /* invalid, corrupted or unsupported input */
+#define WRK2MID_LIMIT_EXCEEDED  3   /* a resource limit was exceeded */
+#define WRK2MID_SALVAGED        4   /* damaged input, partially converted */
+
+/* Options for wrk2mid_set_option() */
+typedef enum wrk2mid_option {
+    WRK2MID_OPT_FORMAT = 0,         /* SMF format: 0 or 1 (default) */
+    WRK2MID_OPT_OPTIMIZE_SIZE = 1,  /* 1: smaller SMF output */
+    WRK2MID_OPT_SALVAGE = 2,        /* 1: skip damaged chunks */
+    WRK2MID_OPT_MAX_EVENTS = 3,     /* limit: number of events */
+    WRK2MID_OPT_MAX_MEMORY = 4,     /* limit: bytes used by events */
+    WRK2MID_OPT_MAX_SYSEX_BYTES = 5,/* limit: length of a sysex message */
+    WRK2MID_OPT_MAX_TICKS = 6,      /* limit: time of any event in ticks */
+    WRK2MID_OPT_TIMEOUT_MS = 7      /* limit: loading time in milliseconds */
+} wrk2mid_option;
+
+typedef struct wrk2mid_stats {
+    size_t struct_size;             /* set by the caller: sizeof(wrk2mid_stats) */
+    int result;                     /* result of the last conversion */
+    int format;                     /* SMF format */
+    int division;                   /* ticks per quarter note */
+    int tracks;                     /* number of tracks */
+    long long events;               /* number of events */
+    long long ticks;                /* song length in ticks */
+    long long duration_us;          /* song length in microseconds */
+    long long input_size;           /* bytes of WRK data */
+    long long output_size;          /* bytes of SMF data */
+} wrk2mid_stats;
+
+typedef struct wrk2mid_converter wrk2mid_converter;
+
+WRK2MID_API const char* wrk2mid_version(void);
+
+WRK2MID_API wrk2mid_converter* wrk2mid_create(void);
+WRK2MID_API int wrk2mid_set_option(wrk2mid_converter* conv, wrk2mid_option option, long long value);
+WRK2MID_API int wrk2mid_convert(wrk2mid_converter* conv, const void* data, size_t size);
+WRK2MID_API const void* wrk2mid_output(const wrk2mid_converter* conv, size_t* size);
+/* Diagnostics of the last conversion, one per line (UTF-8), or an empty string */
+WRK2MID_API const char* wrk2mid_messages(const wrk2mid_converter* conv);
+WRK2MID_API int wrk2mid_get_stats(const wrk2mid_converter* conv, wrk2mid_stats* stats);
+WRK2MID_API void wrk2mid_free(wrk2mid_converter* conv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WRK2MID_H */
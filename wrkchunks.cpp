@@ -0,0 +1,181 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtEndian>
+#include "wrkchunks.h"
+
+static const char WRK_HEADER[] = "CAKEWALK";
+
+bool isWrkHeader(const QByteArray& data)
+{
+    return data.size() >= WRK_HEADER_SIZE && data.startsWith(WRK_HEADER);
+}
+
+bool isKnownWrkChunk(int id)
+{
+    switch (WrkChunkId(id)) {
+    case WrkChunkId::Track:
+    case WrkChunkId::Stream:
+    case WrkChunkId::Vars:
+    case WrkChunkId::Tempo:
+    case WrkChunkId::Meter:
+    case WrkChunkId::Sysex:
+    case WrkChunkId::MemRegion:
+    case WrkChunkId::Comments:
+    case WrkChunkId::TrackOffset:
+    case WrkChunkId::TimeBase:
+    case WrkChunkId::TimeFormat:
+    case WrkChunkId::TrackReps:
+    case WrkChunkId::TrackPatch:
+    case WrkChunkId::NewTempo:
+    case WrkChunkId::Thru:
+    case WrkChunkId::Lyrics:
+    case WrkChunkId::TrackVol:
+    case WrkChunkId::Sysex2:
+    case WrkChunkId::Markers:
+    case WrkChunkId::StringTable:
+    case WrkChunkId::MeterKey:
+    case WrkChunkId::TrackName:
+    case WrkChunkId::Variable:
+    case WrkChunkId::NewTrackOffset:
+    case WrkChunkId::TrackBank:
+    case WrkChunkId::NewTrack:
+    case WrkChunkId::NewSysex:
+    case WrkChunkId::NewStream:
+    case WrkChunkId::Segment:
+    case WrkChunkId::SoftVer:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static qint64 chunkLength(const QByteArray& data, qint64 pos)
+{
+    return qFromLittleEndian<quint32>(data.constData() + pos + 1);
+}
+
+/*
+ * The end of a chunk starting at pos, or -1 if its length prefix does not
+ * fit in the data.
+ */
+static qint64 chunkEnd(const QByteArray& data, qint64 pos)
+{
+    const qint64 size = data.size();
+    if (pos + WRK_CHUNK_PREFIX > size) {
+        return -1;
+    }
+    qint64 next = pos + WRK_CHUNK_PREFIX + chunkLength(data, pos);
+    return next <= size ? next : -1;
+}
+
+/*
+ * A chunk is well framed if its length fits in the data. Known IDs need
+ * nothing else, like the parser, which skips the chunks that it does not
+ * know. A chunk with an unknown ID must also be followed by the end of
+ * the data, the END chunk, or another chunk fitting in the data, so a
+ * damaged byte is not taken for a chunk swallowing the rest of the file.
+ */
+static qint64 framedChunkEnd(const QByteArray& data, qint64 pos)
+{
+    qint64 next = chunkEnd(data, pos);
+    if (next < 0 || isKnownWrkChunk(quint8(data.at(pos)))) {
+        return next;
+    }
+    if (next == data.size() || quint8(data.at(next)) == quint8(WrkChunkId::End) || chunkEnd(data, next) >= 0) {
+        return next;
+    }
+    return -1;
+}
+
+/*
+ * Resynchronization after a framing failure is stricter: a chunk is
+ * plausible if its ID is known, its length fits in the data,
+ * and the next byte is either the end of the data or another known ID.
+ */
+static bool isPlausibleChunk(const QByteArray& data, qint64 pos)
+{
+    const qint64 size = data.size();
+    if (pos >= size) {
+        return false;
+    }
+    int id = quint8(data.at(pos));
+    if (id == int(WrkChunkId::End)) {
+        return true;
+    }
+    if (!isKnownWrkChunk(id) || pos + WRK_CHUNK_PREFIX > size) {
+        return false;
+    }
+    qint64 next = pos + WRK_CHUNK_PREFIX + chunkLength(data, pos);
+    if (next > size) {
+        return false;
+    }
+    if (next == size) {
+        return true;
+    }
+    int nextId = quint8(data.at(next));
+    return nextId == int(WrkChunkId::End) || isKnownWrkChunk(nextId);
+}
+
+bool scanWrkChunks(const QByteArray& data, QList<WrkChunkInfo>& chunks, QList<ByteRange>& skipped)
+{
+    chunks.clear();
+    skipped.clear();
+    if (!isWrkHeader(data)) {
+        return false;
+    }
+    const qint64 size = data.size();
+    qint64 pos = WRK_HEADER_SIZE;
+    while (pos < size) {
+        int id = quint8(data.at(pos));
+        if (id == int(WrkChunkId::End)) {
+            break;
+        }
+        qint64 next = framedChunkEnd(data, pos);
+        if (next >= 0) {
+            chunks.append({ id, pos, next - pos - WRK_CHUNK_PREFIX });
+            pos = next;
+            continue;
+        }
+        qint64 resync = pos + 1;
+        while (resync < size && !isPlausibleChunk(data, resync)) {
+            ++resync;
+        }
+        skipped.append({ pos, resync - pos });
+        pos = resync;
+    }
+    return true;
+}
+
+QByteArray buildWrkFile(const QByteArray& data, const QList<WrkChunkInfo>& chunks, QList<qint64>& offsets)
+{
+    QByteArray result;
+    qint64 total = WRK_HEADER_SIZE + 1;
+    foreach(const WrkChunkInfo& chunk, chunks) {
+        total += WRK_CHUNK_PREFIX + chunk.length;
+    }
+    result.reserve(int(total));
+    result.append(data.constData(), WRK_HEADER_SIZE);
+    offsets.clear();
+    foreach(const WrkChunkInfo& chunk, chunks) {
+        offsets.append(result.size());
+        result.append(data.constData() + chunk.offset, int(WRK_CHUNK_PREFIX + chunk.length));
+    }
+    result.append(char(WrkChunkId::End));
+    return result;
+}
@@ -0,0 +1,90 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WRKCHUNKS_H
+#define WRKCHUNKS_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QList>
+
+/**
+ * @file wrkchunks.h
+ * Low level structure of WRK files.
+ *
+ * A WRK file starts with the header "CAKEWALK", one byte 0x1a and the
+ * version (two bytes: minor, major). A sequence of chunks follows, each
+ * one with one byte ID and a 32 bits little endian length prefix
+ * followed by the chunk data. The last chunk is a single END byte.
+ */
+
+/**
+ * Chunk IDs of the WRK file format
+ */
+enum class WrkChunkId : quint8 {
+    Track = 1, Stream = 2, Vars = 3, Tempo = 4, Meter = 5, Sysex = 6,
+    MemRegion = 7, Comments = 8, TrackOffset = 9, TimeBase = 10,
+    TimeFormat = 11, TrackReps = 12, TrackPatch = 14, NewTempo = 15,
+    Thru = 16, Lyrics = 18, TrackVol = 19, Sysex2 = 20, Markers = 21,
+    StringTable = 22, MeterKey = 23, TrackName = 24, Variable = 26,
+    NewTrackOffset = 27, TrackBank = 30, NewTrack = 36, NewSysex = 44,
+    NewStream = 45, Segment = 49, SoftVer = 74, End = 255
+};
+
+static const int WRK_HEADER_SIZE = 11;
+static const int WRK_CHUNK_PREFIX = 5;
+
+struct ByteRange {
+    qint64 offset;
+    qint64 length;
+};
+
+struct WrkChunkInfo {
+    int id;
+    qint64 offset;  ///< position of the ID byte
+    qint64 length;  ///< data length, without the prefix
+};
+
+bool isWrkHeader(const QByteArray& data);
+bool isKnownWrkChunk(int id);
+
+/**
+ * Scans the chunk structure of a WRK file in memory, skipping damaged
+ * areas. Chunks with any ID are accepted when their length frames them
+ * correctly (for unknown IDs, the next chunk must fit in the file too).
+ * A chunk that can't be framed is skipped, resuming at the next position
+ * holding a plausible chunk: a known ID with a length prefix that fits in
+ * the file and is followed by another known chunk ID or the end of the file.
+ * @param data The file contents.
+ * @param chunks The well formed chunks, except the END chunk.
+ * @param skipped The ranges of bytes skipped.
+ * @return true if the file has a WRK header.
+ */
+bool scanWrkChunks(const QByteArray& data, QList<WrkChunkInfo>& chunks, QList<ByteRange>& skipped);
+
+/**
+ * Builds a WRK file from the header of the original file and a list of
+ * its chunks, terminated by an END chunk.
+ * @param data The original file contents.
+ * @param chunks The chunks to include.
+ * @param offsets Receives the offset of each chunk in the new file.
+ * @return The new file contents.
+ */
+QByteArray buildWrkFile(const QByteArray& data, const QList<WrkChunkInfo>& chunks, QList<qint64>& offsets);
+
+#endif // WRKCHUNKS_H
@@ -0,0 +1,397 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <limits>
+#include "wrkreader.h"
+
+static const int SKIP_BLOCK = 4096;
+
+WrkReader::WrkReader(QIODevice *device) :
+    m_device(device),
+    m_pos(0),
+    m_remaining(0),
+    m_entries(0),
+    m_chunkId(-1),
+    m_chunkOffset(0),
+    m_chunkTrack(-1),
+    m_major(0),
+    m_minor(0),
+    m_keyPending(false),
+    m_keyBar(0),
+    m_keyAlt(0),
+    m_finished(false)
+{ }
+
+/**
+ * Ignores all the chunks with the given ID. They are skipped by next()
+ * without decoding them.
+ */
+void WrkReader::setChunkIgnored(WrkChunkId id, bool ignored)
+{
+    m_ignored.set(static_cast<quint8>(id), ignored);
+}
+
+bool WrkReader::fail(const QString &error)
+{
+    if (m_errorString.isEmpty()) {
+        m_errorString = error;
+    }
+    return false;
+}
+
+bool WrkReader::readBytes(char *buffer, qint64 len)
+{
+    if (m_chunkId >= 0 && len > m_remaining) {
+        return fail(QStringLiteral("record beyond the end of chunk at offset %1").arg(m_chunkOffset));
+    }
+    if (m_device->read(buffer, len) != len) {
+        return fail(QStringLiteral("unexpected end of file at offset %1").arg(m_pos));
+    }
+    m_pos += len;
+    if (m_chunkId >= 0) {
+        m_remaining -= len;
+    }
+    return true;
+}
+
+/*
+ * Reads bytes into the record buffer, returning a view of them. The
+ * buffer only grows, and the view is valid until the next read.
+ */
+bool WrkReader::readView(qint64 len, QByteArray &view)
+{
+    if (m_chunkId >= 0 && len > m_remaining) {
+        return fail(QStringLiteral("record beyond the end of chunk at offset %1").arg(m_chunkOffset));
+    }
+    if (len > std::numeric_limits<int>::max()) {
+        return fail(QStringLiteral("record too large at offset %1").arg(m_pos));
+    }
+    if (m_buffer.size() < len) {
+        m_buffer.resize(len);
+    }
+    if (!readBytes(m_buffer.data(), len)) {
+        return false;
+    }
+    view = QByteArray::fromRawData(m_buffer.constData(), len);
+    return true;
+}
+
+bool WrkReader::skipBytes(qint64 len)
+{
+    if (m_chunkId >= 0 && len > m_remaining) {
+        return fail(QStringLiteral("chunk beyond the end of file at offset %1").arg(m_chunkOffset));
+    }
+    if (!m_device->isSequential()) {
+        if (m_device->pos() + len > m_device->size() || !m_device->seek(m_device->pos() + len)) {
+            return fail(QStringLiteral("unexpected end of file at offset %1").arg(m_pos));
+        }
+        m_pos += len;
+        if (m_chunkId >= 0) {
+            m_remaining -= len;
+        }
+        return true;
+    }
+    char block[SKIP_BLOCK];
+    while (len > 0) {
+        qint64 n = qMin<qint64>(len, SKIP_BLOCK);
+        if (!readBytes(block, n)) {
+            return false;
+        }
+        len -= n;
+    }
+    return true;
+}
+
+quint32 WrkReader::readInt(int bytes)
+{
+    uchar buffer[4] = { 0, 0, 0, 0 };
+    if (!readBytes(reinterpret_cast<char*>(buffer), bytes)) {
+        return 0;
+    }
+    return buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | (quint32(buffer[3]) << 24);
+}
+
+/**
+ * Reads and checks the file header. It must be called first.
+ * @return true if the device contains a WRK file.
+ */
+bool WrkReader::readHeader()
+{
+    QByteArray header(WRK_HEADER_SIZE, '\0');
+    if (!readBytes(header.data(), WRK_HEADER_SIZE) || !isWrkHeader(header)) {
+        return fail(QStringLiteral("invalid file format"));
+    }
+    m_minor = quint8(header[WRK_HEADER_SIZE - 2]);
+    m_major = quint8(header[WRK_HEADER_SIZE - 1]);
+    return true;
+}
+
+/**
+ * Skips the rest of the current chunk: the next record will be the
+ * first one of the following chunk.
+ */
+void WrkReader::skipChunk()
+{
+    m_entries = 0;
+    m_keyPending = false;
+}
+
+/**
+ * Reads the next record of the file.
+ * @return false after the END record, or on error.
+ */
+bool WrkReader::next()
+{
+    if (m_finished || hasError()) {
+        return false;
+    }
+    if (m_keyPending) {
+        m_keyPending = false;
+        m_record = WrkRecord();
+        m_record.chunkId = m_chunkId;
+        m_record.offset = m_chunkOffset;
+        m_record.type = WrkRecordType::KeySignature;
+        m_record.bar = m_keyBar;
+        m_record.value = m_keyAlt;
+        return true;
+    }
+    if (m_entries > 0) {
+        return readEntry();
+    }
+    return readChunk();
+}
+
+bool WrkReader::readChunk()
+{
+    forever {
+        if (m_chunkId >= 0) {
+            if (m_remaining > 0 && !skipBytes(m_remaining)) {
+                return false;
+            }
+            m_chunkId = -1;
+        }
+        m_record = WrkRecord();
+        m_chunkOffset = m_pos;
+        int id = readInt(1);
+        if (hasError()) {
+            return false;
+        }
+        m_record.chunkId = id;
+        m_record.offset = m_chunkOffset;
+        if (id == static_cast<int>(WrkChunkId::End)) {
+            m_record.type = WrkRecordType::End;
+            m_finished = true;
+            return true;
+        }
+        qint64 len = readInt(4);
+        if (hasError()) {
+            return false;
+        }
+        if (m_ignored.test(id)) {
+            if (!skipBytes(len)) {
+                return false;
+            }
+            continue;
+        }
+        m_chunkId = id;
+        m_remaining = len;
+        switch (static_cast<WrkChunkId>(id)) {
+        case WrkChunkId::Stream:
+            m_chunkTrack = readInt(2);
+            m_entries = readInt(2);
+            m_trackName.clear();
+            break;
+        case WrkChunkId::NewStream: {
+            m_chunkTrack = readInt(2);
+            QByteArray name;
+            if (readView(readInt(1), name)) {
+                m_trackName = QByteArray(name.constData(), name.size());
+            }
+            m_entries = readInt(4);
+            break;
+        }
+        case WrkChunkId::Tempo:
+        case WrkChunkId::NewTempo:
+        case WrkChunkId::Meter:
+        case WrkChunkId::MeterKey:
+            m_entries = readInt(2);
+            break;
+        case WrkChunkId::TimeBase:
+            m_record.type = WrkRecordType::TimeBase;
+            m_record.value = readInt(2);
+            return !hasError();
+        case WrkChunkId::Sysex:
+        case WrkChunkId::Sysex2:
+        case WrkChunkId::NewSysex:
+            return readSysex();
+        default:
+            m_record.type = WrkRecordType::Chunk;
+            return readView(len, m_record.data);
+        }
+        if (hasError()) {
+            return false;
+        }
+        if (m_entries > 0) {
+            return readEntry();
+        }
+    }
+}
+
+bool WrkReader::readEntry()
+{
+    m_entries--;
+    m_record = WrkRecord();
+    m_record.chunkId = m_chunkId;
+    m_record.offset = m_chunkOffset;
+    switch (static_cast<WrkChunkId>(m_chunkId)) {
+    case WrkChunkId::Stream:
+    case WrkChunkId::NewStream:
+        return readStreamEvent();
+    case WrkChunkId::Tempo:
+    case WrkChunkId::NewTempo: {
+        int factor = m_chunkId == static_cast<int>(WrkChunkId::Tempo) ? 100 : 1;
+        m_record.type = WrkRecordType::Tempo;
+        m_record.tick = readInt(4);
+        skipBytes(4);
+        m_record.value = readInt(2) * factor;
+        skipBytes(8);
+        break;
+    }
+    case WrkChunkId::Meter:
+        m_record.type = WrkRecordType::TimeSignature;
+        skipBytes(4);
+        m_record.bar = readInt(2);
+        m_record.data1 = readInt(1);
+        m_record.data2 = 1 << qMin<quint32>(readInt(1), 7);
+        skipBytes(4);
+        break;
+    case WrkChunkId::MeterKey:
+        m_record.type = WrkRecordType::TimeSignature;
+        m_record.bar = readInt(2);
+        m_record.data1 = readInt(1);
+        m_record.data2 = 1 << qMin<quint32>(readInt(1), 7);
+        m_keyBar = m_record.bar;
+        m_keyAlt = static_cast<qint8>(readInt(1));
+        m_keyPending = !hasError();
+        break;
+    default:
+        break;
+    }
+    return !hasError();
+}
+
+/*
+ * Events of the track stream chunks. The old format has fixed size
+ * events; the new one has variable size channel events, and other
+ * events (text, expression, hairpin, chord, sysex) with their own data.
+ */
+bool WrkReader::readStreamEvent()
+{
+    m_record.track = m_chunkTrack;
+    m_record.name = m_trackName;
+    m_record.tick = readInt(3);
+    int status = readInt(1);
+    m_record.status = status;
+    m_record.channel = status & 0x0f;
+    int type = status & 0xf0;
+    if (m_chunkId == static_cast<int>(WrkChunkId::Stream)) {
+        m_record.data1 = readInt(1);
+        m_record.data2 = readInt(1);
+        m_record.duration = readInt(2);
+    } else if (status >= 0x90) {
+        m_record.data1 = readInt(1);
+        if (type == 0x90 || type == 0xa0 || type == 0xb0 || type == 0xe0) {
+            m_record.data2 = readInt(1);
+        }
+        if (type == 0x90) {
+            m_record.duration = readInt(2);
+        }
+    } else {
+        m_record.type = WrkRecordType::StreamData;
+        switch (status) {
+        case 5:     // expression
+            m_record.data1 = readInt(2);
+            return readView(readInt(4), m_record.data);
+        case 6:     // hairpin
+            m_record.data1 = readInt(2);
+            m_record.duration = readInt(2);
+            return skipBytes(4);
+        case 7:     // chord: name and 13 bytes of data
+            return readView(readInt(4) + 13, m_record.data);
+        case 8:     // sysex
+            return readView(readInt(2), m_record.data);
+        default:    // text
+            return readView(readInt(4), m_record.data);
+        }
+    }
+    switch (type) {
+    case 0x90:
+        m_record.type = WrkRecordType::Note;
+        break;
+    case 0xa0:
+        m_record.type = WrkRecordType::KeyPress;
+        break;
+    case 0xb0:
+        m_record.type = WrkRecordType::Controller;
+        break;
+    case 0xc0:
+        m_record.type = WrkRecordType::Program;
+        break;
+    case 0xd0:
+        m_record.type = WrkRecordType::ChannelPressure;
+        break;
+    case 0xe0:
+        m_record.type = WrkRecordType::PitchBend;
+        m_record.value = (m_record.data2 << 7) + m_record.data1 - 8192;
+        break;
+    default:
+        m_record.type = WrkRecordType::StreamData;
+        break;
+    }
+    return !hasError();
+}
+
+/*
+ * Sysex bank chunks: the old format has 8 bits bank numbers and 16 bits
+ * lengths, the newer ones 16 and 32 bits. Sysex2 packs the port in the
+ * high nibble of the autosend byte, and NewSysex has a 16 bits port.
+ */
+bool WrkReader::readSysex()
+{
+    bool old = m_chunkId == static_cast<int>(WrkChunkId::Sysex);
+    m_record.type = WrkRecordType::Sysex;
+    m_record.value = readInt(old ? 1 : 2);
+    qint64 len = readInt(old ? 2 : 4);
+    if (m_chunkId == static_cast<int>(WrkChunkId::NewSysex)) {
+        m_record.data2 = readInt(2);
+    }
+    int autosend = readInt(1);
+    if (m_chunkId == static_cast<int>(WrkChunkId::Sysex2)) {
+        m_record.data2 = autosend >> 4;
+        autosend &= 0x0f;
+    }
+    m_record.data1 = autosend != 0 ? 1 : 0;
+    int namelen = readInt(1);
+    QByteArray block;
+    if (hasError() || !readView(namelen + len, block)) {
+        return false;
+    }
+    m_record.name = QByteArray::fromRawData(block.constData(), namelen);
+    m_record.data = QByteArray::fromRawData(block.constData() + namelen, len);
+    return true;
+}
@@ -0,0 +1,135 @@
+/*
+    Cakewalk to Standard MIDI Files Command Line Utility Translator
+    Copyright (C) 2021-2026, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WRKREADER_H
+#define WRKREADER_H
+
+#include <bitset>
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include "wrk2mid.h"
+#include "wrkchunks.h"
+
+/**
+ * Kinds of records delivered by WrkReader
+ */
+enum class WrkRecordType {
+    None,
+    Chunk,              ///< a chunk not decoded: data is the chunk payload
+    Note,               ///< channel, data1: key, data2: velocity, duration
+    KeyPress,           ///< channel, data1: key, data2: pressure
+    Controller,         ///< channel, data1: controller, data2: value
+    Program,            ///< channel, data1: program
+    ChannelPressure,    ///< channel, data1: pressure
+    PitchBend,          ///< channel, value: -8192 to 8191
+    StreamData,         ///< a non channel event of a track: status, data
+    Tempo,              ///< value: BPM * 100
+    TimeSignature,      ///< bar, data1: numerator, data2: denominator
+    KeySignature,       ///< bar, value: accidentals (-7 to 7)
+    TimeBase,           ///< value: ticks per quarter note
+    Sysex,              ///< value: bank, data1: autosend (0 or 1), data2: port, name, data
+    End                 ///< the END chunk: the last record
+};
+
+/**
+ * A record of a WRK file. The fields used depend on the type.
+ * The name and data views are valid until the next call to WrkReader::next().
+ */
+struct WrkRecord {
+    WrkRecordType type = WrkRecordType::None;
+    int chunkId = 0;            ///< chunk containing the record
+    qint64 offset = 0;          ///< file position of the chunk ID
+    int track = -1;             ///< track number of stream events
+    long tick = 0;              ///< musical time of events and tempo changes
+    int bar = 0;                ///< measure of time and key signatures
+    int status = 0;             ///< status byte of stream events
+    int channel = 0;
+    int data1 = 0;
+    int data2 = 0;
+    int duration = 0;
+    int value = 0;
+    QByteArray name;
+    QByteArray data;
+};
+
+/**
+ * Pull parser of WRK files.
+ *
+ * Reads one record for each call to next(), in file order, keeping in
+ * memory only the current record: the events of tracks (stream chunks),
+ * tempo changes and meters are decoded one at a time, directly from the
+ * device. Other chunks are delivered as a single Chunk record. Consumers
+ * may stop at any time, skip the rest of the current chunk, or ignore
+ * chunk IDs, which are skipped without reading them if the device is
+ * seekable.
+ *
+ * This is a low level view of the file: track settings such as channel
+ * or transposition are not applied to the events. It is exported by the
+ * wrk2mid library, and installed with it, for C++ programs that process
+ * WRK files without converting them.
+ */
+class WRK2MID_API WrkReader
+{
+public:
+    explicit WrkReader(QIODevice* device);
+
+    bool readHeader();
+    bool next();
+    const WrkRecord& record() const { return m_record; }
+    void skipChunk();
+    void setChunkIgnored(WrkChunkId id, bool ignored = true);
+
+    int majorVersion() const { return m_major; }
+    int minorVersion() const { return m_minor; }
+    bool hasError() const { return !m_errorString.isEmpty(); }
+    QString errorString() const { return m_errorString; }
+    qint64 pos() const { return m_pos; }
+
+private:
+    bool fail(const QString& error);
+    bool readBytes(char* buffer, qint64 len);
+    bool readView(qint64 len, QByteArray& view);
+    bool skipBytes(qint64 len);
+    bool readChunk();
+    bool readEntry();
+    bool readStreamEvent();
+    bool readSysex();
+    quint32 readInt(int bytes);
+
+    QIODevice* m_device;
+    WrkRecord m_record;
+    QByteArray m_buffer;
+    QString m_errorString;
+    std::bitset<256> m_ignored;
+    qint64 m_pos;
+    qint64 m_remaining;     ///< unread bytes of the current chunk
+    qint64 m_entries;       ///< pending records in the current chunk
+    int m_chunkId;          ///< current chunk, or -1 between chunks
+    qint64 m_chunkOffset;
+    int m_chunkTrack;
+    QByteArray m_trackName;
+    int m_major;
+    int m_minor;
+    bool m_keyPending;      ///< the key of a MeterKey entry is the next record
+    int m_keyBar;
+    int m_keyAlt;
+    bool m_finished;
+};
+
+#endif // WRKREADER_H